@@ -10,4 +10,9 @@
 
 + (instancetype)stringWithUnichars:(wchar_t *)unichars;
 
+/**
+ *  The string as zero-terminated wchar_t characters, for passing to UnRAR
+ */
+- (NSData *)unicharsData;
+
 @end
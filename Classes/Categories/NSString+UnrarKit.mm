@@ -19,4 +19,10 @@ RarHppIgnore
                                   encoding:NSUTF32LittleEndianStringEncoding];
 }
 
+- (NSData *)unicharsData {
+    NSMutableData *data = [[self dataUsingEncoding:NSUTF32LittleEndianStringEncoding] mutableCopy];
+    [data increaseLengthBy:sizeof(wchar_t)];
+    return data;
+}
+
 @end
@@ -189,6 +189,25 @@ extern NSString *URKErrorDomain;
  */
 @property (assign) BOOL ignoreCRCMismatches;
 
+/**
+ *  The URL of a header index file for the archive. When set, listing methods read file
+ *  headers from this file instead of scanning the archive, and methods extracting a single
+ *  file find its header position there, as long as the archive is unchanged since the index
+ *  was saved. Otherwise the archive is scanned and the index is saved again after reading
+ *  all headers. Archives with encrypted headers are always scanned
+ */
+@property (nullable, strong) NSURL *headerIndexURL;
+
+/**
+ *  RAR archives can contain quick open information, which stores copies of file headers
+ *  together near the end of the archive. It's used when headers are read one after another,
+ *  like when listing files or searching for a file without a header index, so headers don't
+ *  need to be read from all over the archive. A file found in the header index is read from
+ *  its own location instead. You can read all headers from their original locations by
+ *  setting this property to YES
+ */
+@property (assign) BOOL ignoreQuickOpenInformation;
+
 
 /**
  *  **DEPRECATED:** Creates and returns an archive at the given path
@@ -172,6 +172,7 @@ NS_DESIGNATED_INITIALIZER
         _lastArchivePath = nil;
         _lastFilepath = nil;
         _ignoreCRCMismatches = NO;
+        _ignoreQuickOpenInformation = NO;
 
         if (bookmarkError) {
             URKLogFault("Error creating bookmark to RAR archive: %{public}@", bookmarkError);
@@ -380,8 +381,57 @@ NS_DESIGNATED_INITIALIZER
 {
     URKCreateActivity("Listing Filenames");
 
-    NSArray *files = [self listFileInfo:error];
-    return [files valueForKey:@"filename"];
+    NSMutableOrderedSet<NSString*> *filenames = [NSMutableOrderedSet orderedSet];
+    __weak URKArchive *welf = self;
+
+    BOOL wasSuccessful = [self performActionWithArchiveOpen:^(NSError **innerError) {
+        URKCreateActivity("Performing List Action");
+
+        // UnRAR returns all headers at once in a single block, so no URKFileInfo is created per file.
+        // Only names are needed, so file times and hashes aren't decoded (ROADOF_LAZYEXTRA)
+        struct RARList *list = NULL;
+        int RHCode = RARListAll(welf.rarFile, &list);
+        URKLogDebug("RARListAll returned %d", RHCode);
+
+        if (list) {
+            for (unsigned int i = 0; i < list->EntryCount; i++) {
+                // Files split across volumes are listed once
+                [filenames addObject:[NSString stringWithUTF8String:list->Names + list->Entries[i].FileName]];
+            }
+            RARFreeList(list);
+        }
+
+        // RARListAll stops at a damaged header, so any headers following it are read one by one
+        if (RHCode == ERAR_BAD_DATA && welf.ignoreCRCMismatches) {
+            URKLogInfo("Reading RAR headers following the damaged one...");
+            URKFileInfo *fileInfo = nil;
+            while ([welf readHeader:&RHCode info:&fileInfo] == URKReadHeaderLoopActionContinueReading) {
+                // The header isn't filled in when its CRC doesn't match
+                if (RHCode == ERAR_SUCCESS) {
+                    [filenames addObject:fileInfo.filename];
+                }
+
+                int PFCode = RARProcessFile(welf.rarFile, RAR_SKIP, NULL, NULL);
+                if (PFCode != ERAR_SUCCESS) {
+                    RHCode = PFCode;
+                    break;
+                }
+            }
+        }
+
+        if (![welf didReturnSuccessfully:RHCode]) {
+            NSString *errorName = nil;
+            [welf assignError:innerError code:RHCode errorName:&errorName];
+            URKLogError("Error listing RAR headers: %{public}@ (%d)", errorName, RHCode);
+        }
+    } inMode:RAR_OM_LIST_INCSPLIT opFlags:ROADOF_LAZYEXTRA error:error];
+
+    if (!wasSuccessful) {
+        return nil;
+    }
+
+    URKLogDebug("Found %lu filenames", (unsigned long)filenames.count);
+    return filenames.array;
 }
 
 - (NSArray<URKFileInfo*> *)listFileInfo:(NSError * __autoreleasing *)error
@@ -651,27 +701,8 @@ NS_DESIGNATED_INITIALIZER
         int RHCode = 0, PFCode = 0;
         URKFileInfo *fileInfo;
 
-        URKLogDebug("Reading through RAR header looking for files...");
-        while ([welf readHeader:&RHCode info:&fileInfo] == URKReadHeaderLoopActionContinueReading) {
-            if ([welf headerContainsErrors:innerError]) {
-                URKLogError("Header contains an error")
-                return;
-            }
-
-            if ([fileInfo.filename isEqualToString:filePath]) {
-                URKLogDebug("Extracting %{public}@", fileInfo.filename);
-                break;
-            }
-            else {
-                URKLogDebug("Skipping %{public}@", fileInfo.filename);
-                if ((PFCode = RARProcessFileW(welf.rarFile, RAR_SKIP, NULL, NULL)) != 0) {
-                    NSString *errorName = nil;
-                    [welf assignError:innerError code:(NSInteger)PFCode errorName:&errorName];
-                    URKLogError("Error skipping file: %{public}@ (%d)", errorName, PFCode);
-                    return;
-                }
-            }
-        }
+        URKLogDebug("Looking up RAR header of %{public}@...", filePath);
+        RHCode = [welf readHeaderOfFile:filePath info:&fileInfo];
 
         if (RHCode != ERAR_SUCCESS) {
             NSString *errorName = nil;
@@ -680,6 +711,13 @@ NS_DESIGNATED_INITIALIZER
             return;
         }
 
+        if ([welf headerContainsErrors:innerError]) {
+            URKLogError("Header contains an error")
+            return;
+        }
+
+        URKLogDebug("Extracting %{public}@", fileInfo.filename);
+
         // Empty file, or a directory
         if (fileInfo.uncompressedSize == 0) {
             URKLogDebug("%{public}@ is empty or a directory", fileInfo.filename);
@@ -687,7 +725,16 @@ NS_DESIGNATED_INITIALIZER
             return;
         }
 
-        NSMutableData *fileData = [NSMutableData dataWithCapacity:(NSUInteger)fileInfo.uncompressedSize];
+        // UnRAR unpacks straight into this buffer, so data isn't copied again in the callback
+        size_t bufferSize = (size_t)fileInfo.uncompressedSize;
+        UInt8 *buffer = (UInt8 *)malloc(bufferSize);
+        if (!buffer && bufferSize > 0) {
+            NSString *errorName = nil;
+            [welf assignError:innerError code:ERAR_NO_MEMORY errorName:&errorName];
+            URKLogError("Error allocating %zu bytes for file data: %{public}@", bufferSize, errorName);
+            return;
+        }
+
         CGFloat totalBytes = fileInfo.uncompressedSize;
         progress.totalUnitCount = totalBytes;
         __block long long bytesRead = 0;
@@ -696,12 +743,11 @@ NS_DESIGNATED_INITIALIZER
             progressBlock(0.0);
         }
 
-        BOOL (^bufferedReadBlock)(NSData*) = ^BOOL(NSData *dataChunk) {
-            URKLogDebug("Appending buffered data (%lu bytes)", (unsigned long)dataChunk.length);
-            [fileData appendData:dataChunk];
-            progress.completedUnitCount += dataChunk.length;
+        BOOL (^progressReadBlock)(long long) = ^BOOL(long long chunkLength) {
+            URKLogDebug("Unpacked data chunk (%lld bytes)", chunkLength);
+            progress.completedUnitCount += chunkLength;
 
-            bytesRead += dataChunk.length;
+            bytesRead += chunkLength;
 
             if (progressBlock) {
                 progressBlock(bytesRead / totalBytes);
@@ -714,14 +760,15 @@ NS_DESIGNATED_INITIALIZER
             
             return YES;
         };
-        RARSetCallback(welf.rarFile, BufferedReadCallbackProc, (long)bufferedReadBlock);
+        RARSetCallback(welf.rarFile, ProgressCallbackProc, (long)progressReadBlock);
 
         URKLogInfo("Processing file...");
-        PFCode = RARProcessFile(welf.rarFile, RAR_TEST, NULL, NULL);
+        PFCode = RARProcessFileToMemory(welf.rarFile, buffer, bufferSize);
         
         RARSetCallback(welf.rarFile, NULL, NULL);
         
         if (progress.isCancelled) {
+            free(buffer);
             NSString *errorName = nil;
             [welf assignError:innerError code:URKErrorCodeUserCancelled errorName:&errorName];
             URKLogInfo("Returning nil data from extraction due to user cancellation: %{public}@", errorName);
@@ -729,13 +776,14 @@ NS_DESIGNATED_INITIALIZER
         }
 
         if (![welf didReturnSuccessfully:PFCode]) {
+            free(buffer);
             NSString *errorName = nil;
             [welf assignError:innerError code:(NSInteger)PFCode errorName:&errorName];
             URKLogError("Error extracting file data: %{public}@ (%d)", errorName, PFCode);
             return;
         }
 
-        result = [NSData dataWithData:fileData];
+        result = [NSData dataWithBytesNoCopy:buffer length:bufferSize freeWhenDone:YES];
     } inMode:RAR_OM_EXTRACT error:error];
 
     if (!success) {
@@ -855,14 +903,12 @@ NS_DESIGNATED_INITIALIZER
             }
 
             UInt8 *buffer = (UInt8 *)malloc((size_t)info.uncompressedSize * sizeof(UInt8));
-            UInt8 *callBackBuffer = buffer;
-
-            RARSetCallback(welf.rarFile, CallbackProc, (long) &callBackBuffer);
 
             URKLogInfo("Processing file...");
-            PFCode = RARProcessFile(welf.rarFile, RAR_TEST, NULL, NULL);
+            PFCode = RARProcessFileToMemory(welf.rarFile, buffer, (size_t)info.uncompressedSize);
 
             if (![welf didReturnSuccessfully:PFCode]) {
+                free(buffer);
                 NSString *errorName = nil;
                 [welf assignError:innerError code:(NSInteger)PFCode errorName:&errorName];
                 URKLogError("Error processing file: %{public}@ (%d)", errorName, PFCode);
@@ -912,30 +958,14 @@ NS_DESIGNATED_INITIALIZER
         int RHCode = 0, PFCode = 0;
         URKFileInfo *fileInfo;
 
-        URKLogInfo("Looping through files, looking for %{public}@...", filePath);
-        
-        while ([welf readHeader:&RHCode info:&fileInfo] == URKReadHeaderLoopActionContinueReading) {
-            if ([welf headerContainsErrors:innerError]) {
-                URKLogDebug("Header contains error")
-                return;
-            }
+        URKLogInfo("Looking up %{public}@...", filePath);
+        RHCode = [welf readHeaderOfFile:filePath info:&fileInfo];
 
-            if ([fileInfo.filename isEqualToString:filePath]) {
-                URKLogDebug("Found desired file");
-                break;
-            }
-            else {
-                URKLogDebug("Skipping file...");
-                PFCode = RARProcessFile(welf.rarFile, RAR_SKIP, NULL, NULL);
-                if (![welf didReturnSuccessfully:PFCode]) {
-                    NSString *errorName = nil;
-                    [welf assignError:innerError code:(NSInteger)PFCode errorName:&errorName];
-                    URKLogError("Failed to skip file: %{public}@ (%d)", errorName, PFCode);
-                    return;
-                }
-            }
+        if (RHCode == ERAR_SUCCESS && [welf headerContainsErrors:innerError]) {
+            URKLogDebug("Header contains error")
+            return;
         }
-        
+
         long long totalBytes = fileInfo.uncompressedSize;
         progress.totalUnitCount = totalBytes;
         
@@ -1013,6 +1043,7 @@ NS_DESIGNATED_INITIALIZER
         NSError *error = nil;
         if (![self _unrarOpenFile:self.filename
                            inMode:RAR_OM_EXTRACT
+                          opFlags:0
                      withPassword:nil
                             error:&error])
         {
@@ -1200,32 +1231,6 @@ NS_DESIGNATED_INITIALIZER
 #pragma mark - Callback Functions
 
 
-int CALLBACK CallbackProc(UINT msg, long UserData, long P1, long P2) {
-    URKCreateActivity("CallbackProc");
-
-    UInt8 **buffer;
-
-    switch(msg) {
-        case UCM_CHANGEVOLUME:
-            URKLogDebug("msg: UCM_CHANGEVOLUME");
-            break;
-
-        case UCM_PROCESSDATA:
-            URKLogDebug("msg: UCM_PROCESSDATA; Copying data");
-            buffer = (UInt8 **) UserData;
-            memcpy(*buffer, (UInt8 *)P1, P2);
-            // advance the buffer ptr, original m_buffer ptr is untouched
-            *buffer += P2;
-            break;
-
-        case UCM_NEEDPASSWORD:
-            URKLogDebug("msg: UCM_NEEDPASSWORD");
-            break;
-    }
-
-    return 0;
-}
-
 int CALLBACK BufferedReadCallbackProc(UINT msg, long UserData, long P1, long P2) {
     URKCreateActivity("BufferedReadCallbackProc");
     BOOL (^bufferedReadBlock)(NSData*) = (__bridge BOOL(^)(NSData*))(void *)UserData;
@@ -1245,6 +1250,22 @@ int CALLBACK BufferedReadCallbackProc(UINT msg, long UserData, long P1, long P2)
     return 0;
 }
 
+int CALLBACK ProgressCallbackProc(UINT msg, long UserData, long P1, long P2) {
+    URKCreateActivity("ProgressCallbackProc");
+    BOOL (^progressReadBlock)(long long) = (__bridge BOOL(^)(long long))(void *)UserData;
+
+    if (msg == UCM_PROCESSDATA) {
+        URKLogDebug("msg: UCM_PROCESSDATA; Reporting progress, data is unpacked to memory");
+        BOOL cancelRequested = !progressReadBlock(P2);
+        
+        if (cancelRequested) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, long P2) {
     URKCreateActivity("AllowCancellationCallbackProc");
     BOOL (^shouldCancelBlock)() = (__bridge BOOL(^)())(void *)UserData;
@@ -1270,7 +1291,15 @@ int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, lon
                               inMode:(NSInteger)mode
                                error:(NSError * __autoreleasing *)error
 {
-    URKCreateActivity("-performActionWithArchiveOpen:inMode:error:");
+    return [self performActionWithArchiveOpen:action inMode:mode opFlags:0 error:error];
+}
+
+- (BOOL)performActionWithArchiveOpen:(void(^)(NSError **innerError))action
+                              inMode:(NSInteger)mode
+                             opFlags:(uint)opFlags
+                               error:(NSError * __autoreleasing *)error
+{
+    URKCreateActivity("-performActionWithArchiveOpen:inMode:opFlags:error:");
 
     @synchronized(self.threadLock) {
         URKLogDebug("Entered lock");
@@ -1285,6 +1314,7 @@ int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, lon
         
         if (![self _unrarOpenFile:self.filename
                            inMode:mode
+                          opFlags:opFlags
                      withPassword:self.password
                             error:&openFileError]) {
             URKLogError("Failed to open archive: %{public}@", openFileError);
@@ -1318,9 +1348,9 @@ int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, lon
     }
 }
 
-- (BOOL)_unrarOpenFile:(NSString *)rarFile inMode:(NSInteger)mode withPassword:(NSString *)aPassword error:(NSError * __autoreleasing *)error
+- (BOOL)_unrarOpenFile:(NSString *)rarFile inMode:(NSInteger)mode opFlags:(uint)opFlags withPassword:(NSString *)aPassword error:(NSError * __autoreleasing *)error
 {
-    URKCreateActivity("-_unrarOpenFile:inMode:withPassword:error:");
+    URKCreateActivity("-_unrarOpenFile:inMode:opFlags:withPassword:error:");
 
     if (error) {
         URKLogDebug("Error pointer passed in");
@@ -1340,11 +1370,21 @@ int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, lon
     
     self.flags->ArcName = strdup(rarFile.UTF8String);
     self.flags->OpenMode = (uint)mode;
-    self.flags->OpFlags = self.ignoreCRCMismatches ? ROADOF_KEEPBROKEN : 0;
+    self.flags->OpFlags = opFlags | (self.ignoreCRCMismatches ? ROADOF_KEEPBROKEN : 0);
+    self.flags->QOpenMode = self.ignoreQuickOpenInformation ? RAR_QOPEN_NONE : RAR_QOPEN_AUTO;
+
+    // The index name is copied when opening, so the buffer only needs to live until then
+    NSData *indexName = nil;
+    if (self.headerIndexURL.path) {
+        URKLogDebug("Setting header index %{public}@...", self.headerIndexURL.path);
+        indexName = [self.headerIndexURL.path unicharsData];
+        self.flags->IndexNameW = (wchar_t *)indexName.bytes;
+    }
 
     URKLogDebug("Opening archive %{public}@...", rarFile);
     
     self.rarFile = RAROpenArchiveEx(self.flags);
+    self.flags->IndexNameW = NULL;
     if (self.rarFile == 0 || self.flags->OpenResult != 0) {
         NSString *errorName = nil;
         [self assignError:error code:(NSInteger)self.flags->OpenResult errorName:&errorName];
@@ -1774,6 +1814,45 @@ int CALLBACK AllowCancellationCallbackProc(UINT msg, long UserData, long P1, lon
     return result;
 }
 
+- (int)readHeaderOfFile:(NSString *)filePath
+                   info:(URKFileInfo *__autoreleasing *)info
+{
+    NSAssert(info != NULL, @"info argument is required");
+
+    // With a header index UnRAR finds the header by name, without reading all headers preceding it.
+    // Otherwise its first lookup would read the headers of all volumes, so they're read up to the file
+    if (self.headerIndexURL) {
+        URKLogDebug("Looking up RAR header of %{public}@ in index", filePath);
+        NSData *fileName = [filePath unicharsData];
+        int returnCode = RARReadHeaderByName(self.rarFile, (const wchar_t *)fileName.bytes, self.header);
+        URKLogDebug("RARReadHeaderByName returned %d", returnCode);
+
+        *info = [URKFileInfo fileInfo:self.header];
+        return returnCode;
+    }
+
+    URKLogDebug("Reading through RAR headers looking for %{public}@...", filePath);
+    int returnCode = ERAR_SUCCESS;
+    while ([self readHeader:&returnCode info:info] == URKReadHeaderLoopActionContinueReading) {
+        if ([self headerContainsErrors:nil]) {
+            return ERAR_MISSING_PASSWORD;
+        }
+
+        if ([(*info).filename isEqualToString:filePath]) {
+            return returnCode;
+        }
+
+        URKLogDebug("Skipping %{public}@", (*info).filename);
+        int skipCode = RARProcessFile(self.rarFile, RAR_SKIP, NULL, NULL);
+        if (![self didReturnSuccessfully:skipCode]) {
+            URKLogError("Error skipping %{public}@ (%d)", (*info).filename, skipCode);
+            return skipCode;
+        }
+    }
+
+    return returnCode;
+}
+
 - (BOOL)didReturnSuccessfully:(int)returnCode {
     return (returnCode == ERAR_SUCCESS
             || returnCode == ERAR_END_ARCHIVE
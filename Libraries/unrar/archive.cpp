@@ -50,6 +50,13 @@ Archive::Archive(RAROptions *InitCmd)
   ProhibitQOpen=false;
 #endif
 
+  HeaderReadAhead=false;
+  RABufPos=0;
+  RABufSize=0;
+  RAChunk=HEADER_RA_MIN*8;
+  RAPos=0;
+
+  LazyExtraPending=false;
 }
 
 
@@ -300,39 +307,237 @@ uint Archive::FullHeaderSize(size_t Size)
 
 
 
-#ifdef USE_QOPEN
+#if defined(USE_QOPEN) || defined(USE_ARCMEM)
 bool Archive::Open(const wchar *Name,uint Mode)
 {
+#ifdef USE_QOPEN
   // Important if we reuse Archive object and it has virtual QOpen
   // file position not matching real. For example, for 'l -v volname'.
   QOpen.Unload();
+#endif
+  // New volume, so previous read-ahead data is not valid.
+  RABufSize=0;
+  RAPos=0;
+  SetNoCache(Cmd->ReadNoCache);
+
+#ifdef USE_ARCMEM
+  // Next volumes of archive opened from memory are read from files.
+  // For stream it depends on availability of volume open callback.
+  ArcMem.Unload();
+  ArcStrm.Unload();
+  if (ArcMem.Load(Name) || ArcStrm.Load(Name))
+  {
+    File::Close();
+    wcsncpyz(FileName,Name,ASIZE(FileName));
+    return true;
+  }
+  if (ArcStrm.OpensVolumes())
+    return false;
+
+  bool Success=File::Open(Name,Mode);
 
+  // Mapped file can be closed, mapping remains valid.
+  if (Success && Cmd->DllMapArchive && (Mode & (FMF_UPDATE|FMF_WRITE))==0 &&
+      ArcMem.Map(Name,*this))
+    File::Close();
+  return Success;
+#else
   return File::Open(Name,Mode);
+#endif
 }
 
 
 int Archive::Read(void *Data,size_t Size)
 {
+#ifdef USE_QOPEN
   size_t Result;
   if (QOpen.Read(Data,Size,Result))
     return (int)Result;
-  return File::Read(Data,Size);
+#endif
+  return ArcRead(Data,Size);
 }
 
 
 void Archive::Seek(int64 Offset,int Method)
 {
-  if (!QOpen.Seek(Offset,Method))
-    File::Seek(Offset,Method);
+#ifdef USE_QOPEN
+  if (QOpen.Seek(Offset,Method))
+    return;
+#endif
+  ArcSeek(Offset,Method);
 }
 
 
 int64 Archive::Tell()
 {
+#ifdef USE_QOPEN
   int64 QPos;
   if (QOpen.Tell(&QPos))
     return QPos;
+#endif
+  return ArcTell();
+}
+#endif
+
+
+#ifdef USE_ARCMEM
+// Open archive stored in caller memory block. Name is used in messages
+// and to find next volumes, it does not need to exist.
+bool Archive::OpenMemory(const wchar *Name,const void *Data,size_t Size)
+{
+  ArcMem.Set(Name,(const byte *)Data,Size);
+  return Open(Name);
+}
+
+
+// Open archive read through caller callbacks.
+bool Archive::OpenStream(const wchar *Name,const RARArchiveStream *Stream)
+{
+  ArcStrm.Set(Name,Stream);
+  return Open(Name);
+}
+
+
+bool Archive::Close()
+{
+  ArcMem.Unload();
+  ArcStrm.Unload();
+  return File::Close();
+}
+#endif
+
+
+// Read archive data from memory, stream or file.
+int Archive::SrcRead(void *Data,size_t Size)
+{
+#ifdef USE_ARCMEM
+  size_t Result;
+  if (ArcMem.Read(Data,Size,Result) || ArcStrm.Read(Data,Size,Result))
+    return (int)Result;
+#endif
+  return File::Read(Data,Size);
+}
+
+
+void Archive::SrcSeek(int64 Offset,int Method)
+{
+#ifdef USE_ARCMEM
+  if (ArcMem.Seek(Offset,Method) || ArcStrm.Seek(Offset,Method))
+    return;
+#endif
+  File::Seek(Offset,Method);
+}
+
+
+int64 Archive::SrcTell()
+{
+#ifdef USE_ARCMEM
+  int64 Pos;
+  if (ArcMem.Tell(&Pos) || ArcStrm.Tell(&Pos))
+    return Pos;
+#endif
   return File::Tell();
 }
+
+
+// Listing archives issues a seek and several small reads per header.
+// In read-ahead mode we read archive in large aligned chunks and serve
+// headers from them, so we do not need I/O to skip small packed data.
+// Mode is ignored for archives in memory.
+void Archive::SetHeaderReadAhead(bool Mode)
+{
+  if (Mode==HeaderReadAhead)
+    return;
+  if (Mode)
+    RAPos=IsOpened() ? SrcTell():0;
+  else
+    if (ReadAheadActive())
+      SrcSeek(RAPos,SEEK_SET);
+  HeaderReadAhead=Mode;
+  RABufSize=0;
+}
+
+
+bool Archive::ReadAheadActive()
+{
+#ifdef USE_ARCMEM
+  if (ArcMem.IsLoaded())
+    return false;
 #endif
+  return HeaderReadAhead;
+}
+
+
+int Archive::ArcRead(void *Data,size_t Size)
+{
+  if (!ReadAheadActive())
+    return SrcRead(Data,Size);
+
+  bool Buffered=RAPos>=RABufPos && RAPos+(int64)Size<=RABufPos+(int64)RABufSize;
+  if (!Buffered)
+  {
+    // Increase the chunk size while next headers are near previous ones
+    // and reduce it if we skip large packed data between them.
+    int64 BufEnd=RABufPos+RABufSize;
+    if (RABufSize>0)
+      if (RAPos>=RABufPos && RAPos<BufEnd+(int64)RAChunk)
+        RAChunk=Min(RAChunk*2,HEADER_RA_MAX);
+      else
+        RAChunk=Max(RAChunk/2,HEADER_RA_MIN);
+
+    // Large reads, such as packed data, do not need the read-ahead.
+    if (Size>RAChunk-HEADER_RA_ALIGN)
+    {
+      RABufSize=0;
+      SrcSeek(RAPos,SEEK_SET);
+      int ReadSize=SrcRead(Data,Size);
+      if (ReadSize>0)
+        RAPos+=ReadSize;
+      return ReadSize;
+    }
+
+    int64 ChunkPos=RAPos & ~(int64)(HEADER_RA_ALIGN-1);
+    if (RABuf.Size()<RAChunk)
+      RABuf.Alloc(RAChunk);
+    SrcSeek(ChunkPos,SEEK_SET);
+    int ReadSize=SrcRead(&RABuf[0],RAChunk);
+    RABufPos=ChunkPos;
+    RABufSize=ReadSize>0 ? ReadSize:0;
+    if (ReadSize<0)
+      return ReadSize;
+  }
+
+  size_t BufOffset=size_t(RAPos-RABufPos);
+  size_t CopySize=BufOffset<RABufSize ? Min(Size,RABufSize-BufOffset):0;
+  if (CopySize>0)
+    memcpy(Data,&RABuf[BufOffset],CopySize);
+  RAPos+=CopySize;
+  return (int)CopySize;
+}
+
+
+void Archive::ArcSeek(int64 Offset,int Method)
+{
+  if (!ReadAheadActive())
+  {
+    SrcSeek(Offset,Method);
+    return;
+  }
+  // No I/O here, we seek before reading the next chunk.
+  if (Method==SEEK_SET)
+    RAPos=Offset;
+  if (Method==SEEK_CUR)
+    RAPos+=Offset;
+  if (Method==SEEK_END)
+  {
+    SrcSeek(Offset,SEEK_END);
+    RAPos=SrcTell();
+  }
+}
+
+
+int64 Archive::ArcTell()
+{
+  return ReadAheadActive() ? RAPos:SrcTell();
+}
 
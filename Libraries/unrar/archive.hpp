@@ -20,9 +20,18 @@ enum ADDSUBDATA_FLAGS
   ASDF_CRYPTIFHEADERS = 8  // Encrypt data after subheader only in -hp mode.
 };
 
+// Extra records of RAR5 headers processed by ProcessExtra50. In lazy mode
+// file times, hash, link and owner records are decoded separately.
+enum EXTRA50_SET {EXTRA50_ALL,EXTRA50_NOTLAZY,EXTRA50_LAZY};
+
 // RAR5 headers must not exceed 2 MB.
 #define MAX_HEADER_SIZE_RAR5 0x200000
 
+// Header read-ahead chunk limits and alignment.
+#define HEADER_RA_MIN   0x2000
+#define HEADER_RA_MAX   0x100000
+#define HEADER_RA_ALIGN 0x1000
+
 class Archive:public File
 {
   private:
@@ -32,13 +41,17 @@ class Archive:public File
     size_t ReadHeader14();
     size_t ReadHeader15();
     size_t ReadHeader50();
-    void ProcessExtra50(RawRead *Raw,size_t ExtraSize,BaseBlock *bb);
+    void ProcessExtra50(RawRead *Raw,size_t ExtraSize,BaseBlock *bb,EXTRA50_SET Set=EXTRA50_ALL);
     void RequestArcPassword();
     void UnexpEndArcMsg();
     void BrokenHeaderMsg();
     void UnkEncVerMsg(const wchar *Name,const wchar *Info);
     bool DoGetComment(Array<wchar> *CmtData);
     bool ReadCommentData(Array<wchar> *CmtData);
+    bool ReadAheadActive();
+    int SrcRead(void *Data,size_t Size);
+    void SrcSeek(int64 Offset,int Method);
+    int64 SrcTell();
 
 #if !defined(RAR_NOCRYPT)
     CryptData HeadersCrypt;
@@ -57,6 +70,22 @@ class Archive:public File
     QuickOpen QOpen;
     bool ProhibitQOpen;
 #endif
+#ifdef USE_ARCMEM
+    ArcMemory ArcMem;
+    ArcStream ArcStrm;
+#endif
+
+    // Read-ahead buffer for small header reads, used when listing.
+    bool HeaderReadAhead;
+    Array<byte> RABuf;
+    int64 RABufPos;   // Archive position of RABuf data.
+    size_t RABufSize; // Size of valid data in RABuf.
+    size_t RAChunk;   // Current read-ahead size.
+    int64 RAPos;      // Current archive position in read-ahead mode.
+
+    // Extra area of FileHead with lazy records not decoded yet.
+    Array<byte> LazyExtra;
+    bool LazyExtraPending;
   public:
     Archive(RAROptions *InitCmd=NULL);
     ~Archive();
@@ -88,14 +117,34 @@ class Archive:public File
 #if 0
     void GetRecoveryInfo(bool Required,int64 *Size,int *Percent);
 #endif
-#ifdef USE_QOPEN
+#if defined(USE_QOPEN) || defined(USE_ARCMEM)
     bool Open(const wchar *Name,uint Mode=FMF_READ);
     int Read(void *Data,size_t Size);
     void Seek(int64 Offset,int Method);
     int64 Tell();
+#endif
+#ifdef USE_QOPEN
     void QOpenUnload() {QOpen.Unload();}
     void SetProhibitQOpen(bool Mode) {ProhibitQOpen=Mode;}
 #endif
+#ifdef USE_ARCMEM
+    bool OpenMemory(const wchar *Name,const void *Data,size_t Size);
+    bool OpenStream(const wchar *Name,const RARArchiveStream *Stream);
+    bool Close();
+    bool IsOpened() {return ArcMem.IsLoaded() || ArcStrm.IsLoaded() || File::IsOpened();}
+    bool IsFileInput() {return !ArcMem.IsLoaded() && !ArcStrm.IsLoaded() && File::IsOpened();}
+    // Current volume is read from caller memory block or stream.
+    bool IsCallerInput() {return (ArcMem.IsLoaded() && !ArcMem.IsMapped()) || ArcStrm.IsLoaded();}
+#else
+    bool IsFileInput() {return File::IsOpened();}
+    bool IsCallerInput() {return false;}
+#endif
+    // Archive data access below the quick open cache layer.
+    int ArcRead(void *Data,size_t Size);
+    void ArcSeek(int64 Offset,int Method);
+    int64 ArcTell();
+    void SetHeaderReadAhead(bool Mode);
+    void ProcessLazyExtra();
 
     BaseBlock ShortBlock;
     MarkHeader MarkHead;
@@ -0,0 +1,576 @@
+#include "rar.hpp"
+
+#ifdef RARDLL
+
+static const byte IndexSign[]={'R','a','r','I','d','x',0x1a,0};
+
+// Index file flags.
+#define INDEXF_INCSPLIT 1 // Continued headers of split files are included.
+
+
+ArcIndex::ArcIndex()
+{
+  IncSplit=false;
+  LookupReady=false;
+}
+
+
+void ArcIndex::Clear()
+{
+  Entries.Reset();
+  Volumes.Reset();
+  Names.Reset();
+  HashTable.Reset();
+  Files.Reset();
+  LookupReady=false;
+}
+
+
+// Start a new index for archive, which headers are added with Add.
+bool ArcIndex::Create(const wchar *ArcName,bool IncSplit)
+{
+  Clear();
+  ArcIndex::IncSplit=IncSplit;
+  return AddVolume(ArcName);
+}
+
+
+size_t ArcIndex::AddName(const wchar *Name)
+{
+  size_t Offset=Names.Size();
+  size_t Size=WideToUtfSize(Name);
+  Names.Add(Size);
+  WideToUtf(Name,&Names[Offset],Size);
+  return Offset;
+}
+
+
+void ArcIndex::GetName(size_t Offset,wchar *Name,size_t MaxSize)
+{
+  UtfToWide(&Names[Offset],Name,MaxSize);
+}
+
+
+// Add volume, which following headers belong to. We keep its size
+// and modification time to check if index is still valid. Volume is added
+// also if it is not found on disk, like archive in memory, but such index
+// can be used only for lookups and must not be saved.
+bool ArcIndex::AddVolume(const wchar *Name)
+{
+  VolumeInfo Vol;
+  Vol.Name=AddName(Name);
+  Vol.Size=0;
+  Vol.mtime=0;
+  FindData fd;
+  bool Found=FindFile::FastFind(Name,&fd) && !fd.IsDir;
+  if (Found)
+  {
+    Vol.Size=fd.Size;
+    Vol.mtime=fd.mtime.GetUnixNS();
+  }
+  Volumes.Push(Vol);
+  return Found;
+}
+
+
+// Add file header at specified volume position. Fields are converted
+// same as RARReadHeaderEx does.
+void ArcIndex::Add(FileHeader *hd,int64 HeadPos)
+{
+  Entry E;
+  E.Volume=(uint)Volumes.Size()-1;
+  E.HeadPos=HeadPos;
+  E.Flags=0;
+  if (hd->SplitBefore)
+    E.Flags|=RHDF_SPLITBEFORE;
+  if (hd->SplitAfter)
+    E.Flags|=RHDF_SPLITAFTER;
+  if (hd->Encrypted)
+    E.Flags|=RHDF_ENCRYPTED;
+  if (hd->Solid)
+    E.Flags|=RHDF_SOLID;
+  if (hd->Dir)
+    E.Flags|=RHDF_DIRECTORY;
+  E.PackSize=hd->PackSize;
+  E.UnpSize=hd->UnpSize;
+  E.mtime=hd->mtime.GetWin();
+  E.ctime=hd->ctime.GetWin();
+  E.atime=hd->atime.GetWin();
+  E.FileTime=hd->mtime.IsSet() ? hd->mtime.GetDos():0;
+  E.FileCRC=hd->FileHash.CRC32;
+  E.FileAttr=hd->FileAttr;
+  E.DictSize=uint(hd->WinSize/1024);
+  E.HostOS=hd->HSType==HSYS_WINDOWS ? HOST_WIN32:HOST_UNIX;
+  E.UnpVer=(byte)hd->UnpVer;
+  E.Method=hd->Method+0x30;
+  memset(E.Hash,0,sizeof(E.Hash));
+  switch (hd->FileHash.Type)
+  {
+    case HASH_RAR14:
+    case HASH_CRC32:
+      E.HashType=RAR_HASH_CRC32;
+      break;
+    case HASH_BLAKE2:
+      E.HashType=RAR_HASH_BLAKE2;
+      memcpy(E.Hash,hd->FileHash.Digest,BLAKE2_DIGEST_SIZE);
+      break;
+    default:
+      E.HashType=RAR_HASH_NONE;
+      break;
+  }
+  E.RedirType=(byte)hd->RedirType;
+  E.DirTarget=hd->DirTarget;
+  E.Name=AddName(hd->FileName);
+  E.RedirName=E.RedirType!=FSREDIR_NONE ? AddName(hd->RedirName):0;
+  Entries.Push(E);
+  LookupReady=false;
+}
+
+
+// Fill header data same as RARReadHeaderEx does for archive header.
+void ArcIndex::GetHeader(size_t Pos,RARHeaderDataEx *D)
+{
+  Entry *E=&Entries[Pos];
+  GetName(Volumes[E->Volume].Name,D->ArcNameW,ASIZE(D->ArcNameW));
+  WideToChar(D->ArcNameW,D->ArcName,ASIZE(D->ArcName));
+  GetName(E->Name,D->FileNameW,ASIZE(D->FileNameW));
+  WideToChar(D->FileNameW,D->FileName,ASIZE(D->FileName));
+#ifdef _WIN_ALL
+  CharToOemA(D->FileName,D->FileName);
+#endif
+  D->Flags=E->Flags;
+  D->PackSize=uint(E->PackSize & 0xffffffff);
+  D->PackSizeHigh=uint(E->PackSize>>32);
+  D->UnpSize=uint(E->UnpSize & 0xffffffff);
+  D->UnpSizeHigh=uint(E->UnpSize>>32);
+  D->HostOS=E->HostOS;
+  D->UnpVer=E->UnpVer;
+  D->FileCRC=E->FileCRC;
+  D->FileTime=E->FileTime;
+  D->MtimeLow=(uint)E->mtime;
+  D->MtimeHigh=(uint)(E->mtime>>32);
+  D->CtimeLow=(uint)E->ctime;
+  D->CtimeHigh=(uint)(E->ctime>>32);
+  D->AtimeLow=(uint)E->atime;
+  D->AtimeHigh=(uint)(E->atime>>32);
+  D->Method=E->Method;
+  D->FileAttr=E->FileAttr;
+  D->CmtSize=0;
+  D->CmtState=0;
+  D->DictSize=E->DictSize;
+  D->HashType=E->HashType;
+  if (E->HashType==RAR_HASH_BLAKE2)
+    memcpy(D->Hash,E->Hash,BLAKE2_DIGEST_SIZE);
+  D->RedirType=E->RedirType;
+  if (E->RedirType!=FSREDIR_NONE && D->RedirName!=NULL &&
+      D->RedirNameSize>0 && D->RedirNameSize<100000)
+    GetName(E->RedirName,D->RedirName,D->RedirNameSize);
+  D->DirTarget=E->DirTarget;
+}
+
+
+void ArcIndex::GetVolumeName(size_t Pos,wchar *Name,size_t MaxSize)
+{
+  GetName(Volumes[Entries[Pos].Volume].Name,Name,MaxSize);
+}
+
+
+// Allocate all headers and their names as a single memory block, which
+// is freed by RARFreeList. Names pool is copied as is, with an empty name
+// appended for files without link target. Continued headers of split files
+// are excluded unless IncSplit is set. Returns NULL if memory is exhausted.
+RARList* ArcIndex::GetList(bool IncSplit)
+{
+  size_t Count=0;
+  for (size_t I=0;I<Entries.Size();I++)
+    if (IncSplit || (Entries[I].Flags & RHDF_SPLITBEFORE)==0)
+      Count++;
+  size_t NamesSize=Names.Size()+1;
+  if (NamesSize>0xffffffff)
+    return NULL;
+  size_t EntriesSize=Count*sizeof(RARListEntry);
+  byte *Block=(byte *)malloc(sizeof(RARList)+EntriesSize+NamesSize);
+  if (Block==NULL)
+    return NULL;
+
+  RARList *List=(RARList *)Block;
+  memset(List,0,sizeof(*List));
+  List->Entries=(RARListEntry *)(Block+sizeof(RARList));
+  List->EntryCount=(uint)Count;
+  List->Names=(char *)(Block+sizeof(RARList)+EntriesSize);
+  List->NamesSize=(uint)NamesSize;
+  if (Names.Size()>0)
+    memcpy(List->Names,&Names[0],Names.Size());
+  List->Names[NamesSize-1]=0;
+
+  RARListEntry *L=List->Entries;
+  for (size_t I=0;I<Entries.Size();I++)
+  {
+    Entry *E=&Entries[I];
+    if (!IncSplit && (E->Flags & RHDF_SPLITBEFORE)!=0)
+      continue;
+    L->PackSize=E->PackSize;
+    L->UnpSize=E->UnpSize;
+    L->Mtime=E->mtime;
+    L->Ctime=E->ctime;
+    L->Atime=E->atime;
+    L->FileName=(uint)E->Name;
+    L->ArcName=(uint)Volumes[E->Volume].Name;
+    L->RedirName=E->RedirType!=FSREDIR_NONE ? (uint)E->RedirName:(uint)NamesSize-1;
+    L->Flags=E->Flags;
+    L->FileCRC=E->FileCRC;
+    L->FileTime=E->FileTime;
+    L->FileAttr=E->FileAttr;
+    L->DictSize=E->DictSize;
+    L->HostOS=E->HostOS;
+    L->UnpVer=E->UnpVer;
+    L->Method=E->Method;
+    L->HashType=E->HashType;
+    L->RedirType=E->RedirType;
+    L->DirTarget=E->DirTarget;
+    L->Reserved[0]=L->Reserved[1]=0;
+    memcpy(L->Hash,E->Hash,sizeof(L->Hash));
+    L++;
+  }
+  return List;
+}
+
+
+// FNV-1a hash of UTF-8 name.
+static uint NameHash(const char *Name)
+{
+  uint Hash=0x811c9dc5;
+  for (;*Name!=0;Name++)
+    Hash=(Hash^(byte)*Name)*0x01000193;
+  return Hash;
+}
+
+
+// Hash table with linear probing. Entries are inserted in archive order,
+// so if several files have the same name, we find the first one.
+void ArcIndex::BuildLookup()
+{
+  size_t HashSize=16;
+  while (HashSize<Entries.Size()*2)
+    HashSize*=2;
+  HashTable.Alloc(HashSize);
+  memset(&HashTable[0],0,HashSize*sizeof(HashTable[0]));
+  Files.SoftReset();
+  for (size_t I=0;I<Entries.Size();I++)
+    if ((Entries[I].Flags & RHDF_SPLITBEFORE)==0)
+    {
+      Files.Push((uint)I);
+      size_t Slot=NameHash(&Names[Entries[I].Name]) & (HashSize-1);
+      while (HashTable[Slot]!=0)
+        Slot=(Slot+1) & (HashSize-1);
+      HashTable[Slot]=(uint)I+1;
+    }
+  LookupReady=true;
+}
+
+
+// Find entry of file with exactly the same name.
+bool ArcIndex::FindName(const wchar *Name,size_t *Pos)
+{
+  if (!LookupReady)
+    BuildLookup();
+  char NameU[4*NM];
+  WideToUtf(Name,NameU,ASIZE(NameU));
+  size_t Mask=HashTable.Size()-1;
+  for (size_t Slot=NameHash(NameU) & Mask;HashTable[Slot]!=0;Slot=(Slot+1) & Mask)
+  {
+    size_t I=HashTable[Slot]-1;
+    if (strcmp(&Names[Entries[I].Name],NameU)==0)
+    {
+      *Pos=I;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// Find entry of file by its number in RAR_OM_LIST listing order.
+bool ArcIndex::FindFile(size_t Number,size_t *Pos)
+{
+  if (!LookupReady)
+    BuildLookup();
+  if (Number>=Files.Size())
+    return false;
+  *Pos=Files[Number];
+  return true;
+}
+
+
+bool ArcIndex::FindVolume(const wchar *Name,uint *Volume)
+{
+  char NameU[4*NM];
+  WideToUtf(Name,NameU,ASIZE(NameU));
+  for (size_t I=0;I<Volumes.Size();I++)
+    if (strcmp(&Names[Volumes[I].Name],NameU)==0)
+    {
+      *Volume=(uint)I;
+      return true;
+    }
+  return false;
+}
+
+
+// Find entry of header at specified volume position. Entries are sorted
+// by volume and position, so we use the binary search.
+bool ArcIndex::FindHeader(const wchar *VolName,int64 HeadPos,size_t *Pos)
+{
+  uint Volume;
+  if (!FindVolume(VolName,&Volume))
+    return false;
+  size_t Low=0,High=Entries.Size();
+  while (Low<High)
+  {
+    size_t Mid=(Low+High)/2;
+    Entry *E=&Entries[Mid];
+    if (E->Volume<Volume || E->Volume==Volume && E->HeadPos<HeadPos)
+      Low=Mid+1;
+    else
+      High=Mid;
+  }
+  if (Low==Entries.Size() || Entries[Low].Volume!=Volume || Entries[Low].HeadPos!=HeadPos)
+    return false;
+  *Pos=Low;
+  return true;
+}
+
+
+// Load index file if it is valid for archive volumes and listing mode.
+bool ArcIndex::Load(const wchar *IndexName,const wchar *ArcName,bool IncSplit)
+{
+  Clear();
+  File IndexFile;
+  IndexFile.SetExceptions(false);
+  if (!IndexFile.Open(IndexName,FMF_READ|FMF_OPENSHARED))
+    return false;
+  int64 Size=IndexFile.FileLength();
+  if (Size<=int64(sizeof(IndexSign)+4) || Size>ARCINDEX_MAX_SIZE)
+    return false;
+
+  RawRead Raw(&IndexFile);
+  if (Raw.Read((size_t)Size)!=(size_t)Size)
+    return false;
+  uint DataCRC=CRC32(0xffffffff,Raw.GetDataPtr(),(size_t)Size-4)^0xffffffff;
+  Raw.SetPos((size_t)Size-4);
+  if (Raw.Get4()!=DataCRC)
+    return false;
+  Raw.Rewind();
+
+  bool Success=ReadIndex(Raw) && Raw.GetPos()==(size_t)Size-4 &&
+               (ArcIndex::IncSplit || !IncSplit) && IsCurrent(ArcName);
+  if (!Success)
+    Clear();
+  return Success;
+}
+
+
+bool ArcIndex::ReadIndex(RawRead &Raw)
+{
+  byte Sign[sizeof(IndexSign)];
+  Raw.GetB(Sign,sizeof(Sign));
+  if (memcmp(Sign,IndexSign,sizeof(Sign))!=0 || Raw.GetV()!=ARCINDEX_VERSION)
+    return false;
+  uint Flags=(uint)Raw.GetV();
+  IncSplit=(Flags & INDEXF_INCSPLIT)!=0;
+
+  // Every volume and entry occupies at least one byte, so we can check
+  // the number of items before allocating memory.
+  uint64 VolCount=Raw.GetV();
+  if (VolCount==0 || VolCount>Raw.DataLeft())
+    return false;
+  for (uint64 I=0;I<VolCount;I++)
+  {
+    VolumeInfo Vol;
+    if (!ReadName(Raw,&Vol.Name))
+      return false;
+    Vol.Size=Raw.GetV();
+    Vol.mtime=Raw.Get8();
+    Volumes.Push(Vol);
+  }
+
+  uint64 Count=Raw.GetV();
+  if (Count>Raw.DataLeft())
+    return false;
+  Entries.Alloc((size_t)Count);
+  for (size_t I=0;I<Entries.Size();I++)
+  {
+    Entry *E=&Entries[I];
+    E->Volume=(uint)Raw.GetV();
+    if (E->Volume>=Volumes.Size())
+      return false;
+    E->HeadPos=Raw.GetV();
+    E->Flags=(uint)Raw.GetV();
+    E->PackSize=Raw.GetV();
+    E->UnpSize=Raw.GetV();
+    E->mtime=Raw.Get8();
+    E->ctime=Raw.Get8();
+    E->atime=Raw.Get8();
+    E->FileTime=Raw.Get4();
+    E->FileCRC=Raw.Get4();
+    E->FileAttr=(uint)Raw.GetV();
+    E->DictSize=(uint)Raw.GetV();
+    E->HostOS=Raw.Get1();
+    E->UnpVer=Raw.Get1();
+    E->Method=Raw.Get1();
+    E->HashType=Raw.Get1();
+    memset(E->Hash,0,sizeof(E->Hash));
+    if (E->HashType==RAR_HASH_BLAKE2)
+      Raw.GetB(E->Hash,BLAKE2_DIGEST_SIZE);
+    E->RedirType=Raw.Get1();
+    E->DirTarget=false;
+    E->RedirName=0;
+    if (E->RedirType!=FSREDIR_NONE)
+    {
+      E->DirTarget=Raw.Get1()!=0;
+      if (!ReadName(Raw,&E->RedirName))
+        return false;
+    }
+    if (!ReadName(Raw,&E->Name))
+      return false;
+  }
+  return true;
+}
+
+
+bool ArcIndex::ReadName(RawRead &Raw,size_t *Offset)
+{
+  uint64 Length=Raw.GetV();
+  if (Length>Raw.DataLeft())
+    return false;
+  *Offset=Names.Size();
+  Names.Add((size_t)Length+1);
+  Raw.GetB(&Names[*Offset],(size_t)Length);
+  Names[*Offset+(size_t)Length]=0;
+  return true;
+}
+
+
+// Index is valid if it starts from archive we open and all its volumes
+// have the same size and modification time as when index was created.
+bool ArcIndex::IsCurrent(const wchar *ArcName)
+{
+  for (size_t I=0;I<Volumes.Size();I++)
+  {
+    VolumeInfo *Vol=&Volumes[I];
+    wchar VolName[NM];
+    GetName(Vol->Name,VolName,ASIZE(VolName));
+    if (I==0 && wcscmp(VolName,ArcName)!=0)
+      return false;
+    FindData fd;
+    if (!FindFile::FastFind(VolName,&fd) || fd.IsDir || fd.Size!=Vol->Size ||
+        fd.mtime.GetUnixNS()!=Vol->mtime)
+      return false;
+  }
+  return true;
+}
+
+
+// Save index to temporary file and rename it, so other processes never
+// read a partially written index.
+bool ArcIndex::Save(const wchar *IndexName)
+{
+  Data.SoftReset();
+  Data.Append((byte *)IndexSign,sizeof(IndexSign));
+  PutV(ARCINDEX_VERSION);
+  PutV(IncSplit ? INDEXF_INCSPLIT:0);
+
+  PutV(Volumes.Size());
+  for (size_t I=0;I<Volumes.Size();I++)
+  {
+    PutName(Volumes[I].Name);
+    PutV(Volumes[I].Size);
+    Put8(Volumes[I].mtime);
+  }
+
+  PutV(Entries.Size());
+  for (size_t I=0;I<Entries.Size();I++)
+  {
+    Entry *E=&Entries[I];
+    PutV(E->Volume);
+    PutV(E->HeadPos);
+    PutV(E->Flags);
+    PutV(E->PackSize);
+    PutV(E->UnpSize);
+    Put8(E->mtime);
+    Put8(E->ctime);
+    Put8(E->atime);
+    Put4(E->FileTime);
+    Put4(E->FileCRC);
+    PutV(E->FileAttr);
+    PutV(E->DictSize);
+    Put1(E->HostOS);
+    Put1(E->UnpVer);
+    Put1(E->Method);
+    Put1(E->HashType);
+    if (E->HashType==RAR_HASH_BLAKE2)
+      Data.Append(E->Hash,BLAKE2_DIGEST_SIZE);
+    Put1(E->RedirType);
+    if (E->RedirType!=FSREDIR_NONE)
+    {
+      Put1(E->DirTarget ? 1:0);
+      PutName(E->RedirName);
+    }
+    PutName(E->Name);
+  }
+  Put4(CRC32(0xffffffff,&Data[0],Data.Size())^0xffffffff);
+
+  wchar TmpName[NM];
+  wcsncpyz(TmpName,IndexName,ASIZE(TmpName));
+  wcsncatz(TmpName,L".tmp",ASIZE(TmpName));
+  File TmpFile;
+  TmpFile.SetExceptions(false);
+  bool Success=TmpFile.Create(TmpName,FMF_WRITE|FMF_SHAREREAD);
+  if (Success)
+  {
+    Success=TmpFile.Write(&Data[0],Data.Size());
+    Success&=TmpFile.Close();
+    // Windows does not replace existing files when renaming.
+    if (Success && !RenameFile(TmpName,IndexName))
+      Success=DelFile(IndexName) && RenameFile(TmpName,IndexName);
+    if (!Success)
+      DelFile(TmpName);
+  }
+  Data.Reset();
+  return Success;
+}
+
+
+void ArcIndex::Put4(uint32 Field)
+{
+  byte Buf[4];
+  RawPut4(Field,Buf);
+  Data.Append(Buf,sizeof(Buf));
+}
+
+
+void ArcIndex::Put8(uint64 Field)
+{
+  byte Buf[8];
+  RawPut8(Field,Buf);
+  Data.Append(Buf,sizeof(Buf));
+}
+
+
+// Variable length integer in the same format as in RAR5 headers.
+void ArcIndex::PutV(uint64 Field)
+{
+  for (;Field>=0x80;Field>>=7)
+    Put1(byte(Field|0x80));
+  Put1((byte)Field);
+}
+
+
+void ArcIndex::PutName(size_t Offset)
+{
+  const char *Name=&Names[Offset];
+  size_t Length=strlen(Name);
+  PutV(Length);
+  Data.Append((byte *)Name,Length);
+}
+
+#endif
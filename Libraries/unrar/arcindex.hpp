@@ -0,0 +1,95 @@
+#ifndef _RAR_ARCINDEX_
+#define _RAR_ARCINDEX_
+
+// Version of index file format. Index files of other versions are ignored
+// and created again.
+#define ARCINDEX_VERSION 1
+
+// We do not load larger index files.
+#define ARCINDEX_MAX_SIZE 0x40000000
+
+// File headers returned by DLL listing, saved to separate index file.
+// Next listings of the same archive read the index instead of parsing
+// archive headers. Index is bound to names, sizes and modification times
+// of all archive volumes and is not loaded if any of them differs.
+// Header positions in index are also used to find files by name or number
+// without reading preceding headers.
+class ArcIndex
+{
+  public:
+    // Header data as returned in RARHeaderDataEx. Strings are stored
+    // in Names pool in UTF-8.
+    struct Entry
+    {
+      uint Volume;       // Number of volume in Volumes.
+      int64 HeadPos;     // File header position in volume.
+      uint Flags;        // RHDF_* flags.
+      uint64 PackSize;
+      uint64 UnpSize;
+      uint64 mtime;      // Windows FILETIME format.
+      uint64 ctime;
+      uint64 atime;
+      uint FileTime;     // MS DOS format.
+      uint FileCRC;
+      uint FileAttr;
+      uint DictSize;
+      byte HostOS;
+      byte UnpVer;
+      byte Method;
+      byte HashType;
+      byte RedirType;
+      bool DirTarget;
+      byte Hash[32];
+      size_t Name;       // Name offset in Names.
+      size_t RedirName;  // Link target offset in Names.
+    };
+  private:
+    struct VolumeInfo
+    {
+      size_t Name;
+      uint64 Size;
+      uint64 mtime;      // Unix time in nanoseconds.
+    };
+
+    void Clear();
+    size_t AddName(const wchar *Name);
+    void BuildLookup();
+    bool FindVolume(const wchar *Name,uint *Volume);
+    void GetName(size_t Offset,wchar *Name,size_t MaxSize);
+    bool IsCurrent(const wchar *ArcName);
+    bool ReadIndex(RawRead &Raw);
+    bool ReadName(RawRead &Raw,size_t *Offset);
+    void Put1(byte Field) {Data.Push(Field);}
+    void Put4(uint32 Field);
+    void Put8(uint64 Field);
+    void PutV(uint64 Field);
+    void PutName(size_t Offset);
+
+    Array<Entry> Entries;
+    Array<VolumeInfo> Volumes;
+    Array<char> Names;   // Zero terminated UTF-8 strings.
+    Array<byte> Data;    // Index file data when saving.
+    bool IncSplit;       // Continued headers of split files are included.
+
+    // Built by first lookup. Continued headers of split files are excluded.
+    Array<uint> HashTable; // Entry number+1 for name hash, 0 for empty slot.
+    Array<uint> Files;     // Entry numbers in order of listing.
+    bool LookupReady;
+  public:
+    ArcIndex();
+    bool Create(const wchar *ArcName,bool IncSplit);
+    bool Load(const wchar *IndexName,const wchar *ArcName,bool IncSplit);
+    bool Save(const wchar *IndexName);
+    bool AddVolume(const wchar *Name);
+    void Add(FileHeader *hd,int64 HeadPos);
+    void GetHeader(size_t Pos,RARHeaderDataEx *D);
+    void GetVolumeName(size_t Pos,wchar *Name,size_t MaxSize);
+    RARList* GetList(bool IncSplit);
+    bool FindName(const wchar *Name,size_t *Pos);
+    bool FindFile(size_t Number,size_t *Pos);
+    bool FindHeader(const wchar *VolName,int64 HeadPos,size_t *Pos);
+    size_t Count() {return Entries.Size();}
+    Entry* GetEntry(size_t Pos) {return &Entries[Pos];}
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "rar.hpp"
+
+ArcMemory::ArcMemory()
+{
+  Defined=false;
+  Loaded=false;
+  *ArcName=0;
+  ArcData=NULL;
+  ArcSize=0;
+  SeekPos=0;
+  MapAddr=NULL;
+  MapSize=0;
+}
+
+
+ArcMemory::~ArcMemory()
+{
+  Unmap();
+}
+
+
+void ArcMemory::Unmap()
+{
+#ifdef _UNIX
+  if (MapAddr!=NULL)
+    munmap(MapAddr,MapSize);
+#endif
+  MapAddr=NULL;
+  MapSize=0;
+}
+
+
+// Map the entire opened archive file and start reading from mapping.
+// Only regular files are mapped. Changes in file size after mapping
+// are not visible and file truncation results in SIGBUS when reading,
+// so it is not suitable for archives, which are still being written.
+bool ArcMemory::Map(const wchar *Name,File &SrcFile)
+{
+#ifdef _UNIX
+  struct stat st;
+  if (fstat(SrcFile.GetFD(),&st)!=0 || !S_ISREG(st.st_mode) || st.st_size==0 ||
+      (uint64)st.st_size>(uint64)(size_t)-1)
+    return false;
+  void *Addr=mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,SrcFile.GetFD(),0);
+  if (Addr==MAP_FAILED)
+    return false;
+  Unmap();
+  MapAddr=Addr;
+  MapSize=(size_t)st.st_size;
+  Set(Name,(const byte *)MapAddr,MapSize);
+  return Load(Name);
+#else
+  return false;
+#endif
+}
+
+
+void ArcMemory::Set(const wchar *Name,const byte *Data,size_t Size)
+{
+  Defined=true;
+  Loaded=false;
+  wcsncpyz(ArcName,Name,ASIZE(ArcName));
+  ArcData=Data;
+  ArcSize=Size;
+}
+
+
+// Start reading from memory block if it is defined for this name.
+bool ArcMemory::Load(const wchar *Name)
+{
+  if (!Defined || wcscmp(Name,ArcName)!=0)
+    return false;
+  SeekPos=0;
+  Loaded=true;
+  return true;
+}
+
+
+bool ArcMemory::Read(void *Data,size_t Size,size_t &Result)
+{
+  if (!Loaded)
+    return false;
+  Result=0;
+  if (SeekPos<ArcSize)
+  {
+    Result=(size_t)Min(Size,ArcSize-SeekPos);
+    memcpy(Data,ArcData+SeekPos,Result);
+    SeekPos+=Result;
+  }
+  return true;
+}
+
+
+bool ArcMemory::Seek(int64 Offset,int Method)
+{
+  if (!Loaded)
+    return false;
+  // Same as for files, we allow to seek past the end of data
+  // and return 0 bytes for subsequent reads.
+  if (Method==SEEK_SET)
+    SeekPos=Offset<0 ? 0:(uint64)Offset;
+  if (Method==SEEK_CUR)
+    SeekPos=(int64)SeekPos+Offset<0 ? 0:SeekPos+Offset;
+  if (Method==SEEK_END)
+    SeekPos=(int64)ArcSize+Offset<0 ? 0:ArcSize+Offset;
+  return true;
+}
+
+
+bool ArcMemory::Tell(int64 *Pos)
+{
+  if (!Loaded)
+    return false;
+  *Pos=SeekPos;
+  return true;
+}
+
+
+
+ArcStream::ArcStream()
+{
+  Defined=false;
+  Loaded=false;
+  memset(&Stream,0,sizeof(Stream));
+  *VolName=0;
+  SeekPos=0;
+  StreamPos=-1;
+}
+
+
+void ArcStream::Set(const wchar *Name,const RARArchiveStream *Stream)
+{
+  Defined=true;
+  Loaded=false;
+  ArcStream::Stream=*Stream;
+  wcsncpyz(VolName,Name,ASIZE(VolName));
+}
+
+
+// Start reading from stream if it is defined and can provide this volume.
+bool ArcStream::Load(const wchar *Name)
+{
+  if (!Defined)
+    return false;
+  if (wcscmp(Name,VolName)!=0)
+  {
+    if (Stream.OpenVolume==NULL || Stream.OpenVolume(Stream.UserData,Name)<0)
+      return false;
+    wcsncpyz(VolName,Name,ASIZE(VolName));
+  }
+  SeekPos=0;
+  StreamPos=-1;
+  Loaded=true;
+  return true;
+}
+
+
+bool ArcStream::Read(void *Data,size_t Size,size_t &Result)
+{
+  if (!Loaded)
+    return false;
+
+  // We seek only before reading, so skipping data with several
+  // consecutive seeks results in a single stream seek call.
+  if (StreamPos!=(int64)SeekPos)
+  {
+    if (Stream.Seek(Stream.UserData,SeekPos)<0)
+      ErrHandler.SeekError(VolName);
+    StreamPos=SeekPos;
+  }
+
+  // Stream can return less data than requested, like pipes do,
+  // so we read until the requested size or the end of data.
+  Result=0;
+  while (Result<Size)
+  {
+    uint ReadSize=(uint)Min(Size-Result,0x40000000);
+    int Code=Stream.Read(Stream.UserData,(byte *)Data+Result,ReadSize);
+    if (Code<0)
+    {
+      StreamPos=-1;
+      ErrHandler.ReadError(VolName);
+      break;
+    }
+    if (Code==0)
+      break;
+    Result+=Code;
+  }
+  SeekPos+=Result;
+  if (StreamPos>=0)
+    StreamPos+=Result;
+  return true;
+}
+
+
+bool ArcStream::Seek(int64 Offset,int Method)
+{
+  if (!Loaded)
+    return false;
+  if (Method==SEEK_SET)
+    SeekPos=Offset<0 ? 0:(uint64)Offset;
+  if (Method==SEEK_CUR)
+    SeekPos=(int64)SeekPos+Offset<0 ? 0:SeekPos+Offset;
+  if (Method==SEEK_END)
+  {
+    int64 StreamSize=Stream.Size(Stream.UserData);
+    if (StreamSize<0)
+      ErrHandler.SeekError(VolName);
+    SeekPos=StreamSize+Offset<0 ? 0:StreamSize+Offset;
+  }
+  return true;
+}
+
+
+bool ArcStream::Tell(int64 *Pos)
+{
+  if (!Loaded)
+    return false;
+  *Pos=SeekPos;
+  return true;
+}
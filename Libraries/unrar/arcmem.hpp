@@ -0,0 +1,61 @@
+#ifndef _RAR_ARCMEM_
+#define _RAR_ARCMEM_
+
+// Archive data in memory block provided by caller or in memory mapped
+// archive file, used instead of file reads. Block is identified by archive
+// name, so we can reopen it by name like a file, for example, after failed
+// attempt to open next volume.
+class ArcMemory
+{
+  private:
+    void Unmap();
+
+    bool Defined;
+    bool Loaded;
+    wchar ArcName[NM];
+    const byte *ArcData;
+    size_t ArcSize;
+    uint64 SeekPos;
+    void *MapAddr;
+    size_t MapSize;
+  public:
+    ArcMemory();
+    ~ArcMemory();
+    void Set(const wchar *Name,const byte *Data,size_t Size);
+    bool Map(const wchar *Name,File &SrcFile);
+    bool Load(const wchar *Name);
+    void Unload() {Loaded=false;}
+    bool IsLoaded() {return Loaded;}
+    bool IsMapped() {return Loaded && MapAddr!=NULL;}
+    bool Read(void *Data,size_t Size,size_t &Result);
+    bool Seek(int64 Offset,int Method);
+    bool Tell(int64 *Pos);
+};
+
+
+// Archive data read through callbacks provided by caller. Stream is
+// switched to another volume with OpenVolume callback if it is present.
+// Otherwise only the first volume is read from stream and next volumes
+// are read from files.
+class ArcStream
+{
+  private:
+    bool Defined;
+    bool Loaded;
+    RARArchiveStream Stream;
+    wchar VolName[NM]; // Volume currently opened in stream.
+    uint64 SeekPos;
+    int64 StreamPos; // Actual stream position, -1 if unknown.
+  public:
+    ArcStream();
+    void Set(const wchar *Name,const RARArchiveStream *Stream);
+    bool Load(const wchar *Name);
+    void Unload() {Loaded=false;}
+    bool IsLoaded() {return Loaded;}
+    bool OpensVolumes() {return Defined && Stream.OpenVolume!=NULL;}
+    bool Read(void *Data,size_t Size,size_t &Result);
+    bool Seek(int64 Offset,int Method);
+    bool Tell(int64 *Pos);
+};
+
+#endif
@@ -796,6 +796,8 @@ size_t Archive::ReadHeader50()
         *(BaseBlock *)hd=ShortBlock;
 
         bool FileBlock=ShortBlock.HeaderType==HEAD_FILE;
+        if (FileBlock)
+          LazyExtraPending=false;
 
         hd->LargeFile=true;
 
@@ -862,7 +864,24 @@ size_t Archive::ReadHeader50()
         // Should do it before converting names, because extra fields can
         // affect name processing, like in case of NTFS streams.
         if (ExtraSize!=0)
-          ProcessExtra50(&Raw,(size_t)ExtraSize,hd);
+          if (FileBlock && Cmd->LazyExtra)
+          {
+            // Most listings need only name, sizes and flags, so we keep
+            // the extra area and decode records not affecting them only
+            // when ProcessLazyExtra is called.
+            size_t ExtraStart=Raw.Size()-(size_t)ExtraSize;
+            if (ExtraStart>=Raw.GetPos())
+            {
+              LazyExtra.Alloc((size_t)ExtraSize);
+              Raw.SetPos(ExtraStart);
+              Raw.GetB(&LazyExtra[0],(size_t)ExtraSize);
+              Raw.SetPos(ExtraStart);
+              LazyExtraPending=true;
+            }
+            ProcessExtra50(&Raw,(size_t)ExtraSize,hd,EXTRA50_NOTLAZY);
+          }
+          else
+            ProcessExtra50(&Raw,(size_t)ExtraSize,hd);
 
         if (FileBlock)
         {
@@ -959,7 +978,21 @@ void Archive::RequestArcPassword()
 #endif
 
 
-void Archive::ProcessExtra50(RawRead *Raw,size_t ExtraSize,BaseBlock *bb)
+// Decode file times, hash, link and owner records of current file header,
+// which were skipped in lazy mode. It must be called before processing
+// the file data.
+void Archive::ProcessLazyExtra()
+{
+  if (!LazyExtraPending)
+    return;
+  LazyExtraPending=false;
+  RawRead Raw;
+  Raw.Read(&LazyExtra[0],LazyExtra.Size());
+  ProcessExtra50(&Raw,LazyExtra.Size(),&FileHead,EXTRA50_LAZY);
+}
+
+
+void Archive::ProcessExtra50(RawRead *Raw,size_t ExtraSize,BaseBlock *bb,EXTRA50_SET Set)
 {
   // Read extra data from the end of block skipping any fields before it.
   size_t ExtraStart=Raw->Size()-ExtraSize;
@@ -1001,6 +1034,14 @@ void Archive::ProcessExtra50(RawRead *Raw,size_t ExtraSize,BaseBlock *bb)
       }
     }
 
+    bool LazyField=FieldType==FHEXTRA_HASH || FieldType==FHEXTRA_HTIME ||
+                   FieldType==FHEXTRA_REDIR || FieldType==FHEXTRA_UOWNER;
+    if (Set!=EXTRA50_ALL && LazyField!=(Set==EXTRA50_LAZY))
+    {
+      Raw->SetPos(NextPos);
+      continue;
+    }
+
     if (bb->HeaderType==HEAD_FILE || bb->HeaderType==HEAD_SERVICE)
     {
       FileHeader *hd=(FileHeader *)bb;
@@ -2,6 +2,14 @@
 
 static int RarErrorToDll(RAR_EXIT ErrCode);
 
+// Data of stored file in one volume.
+struct StoredPart
+{
+  wchar VolName[NM];
+  int64 Pos;   // Volume position of part data.
+  int64 Size;  // Size of part data.
+};
+
 struct DataSet
 {
   CommandData Cmd;
@@ -10,7 +18,37 @@ struct DataSet
   int OpenMode;
   int HeaderSize;
 
-  DataSet():Arc(&Cmd),Extract(&Cmd) {};
+  // RARReadAt state for the file returned by the last RARReadHeaderEx.
+  bool ReadAtReady; // File header is current, RARProcessFile is not called.
+  Array<StoredPart> ReadAtParts; // Found by first RARReadAt for this file.
+  File ReadAtVol;   // Other volume than current, containing a file part.
+#ifndef RAR_NOCRYPT
+  CryptData ReadAtCrypt;
+#endif
+
+  // Header index file, which is read instead of archive headers in listing
+  // modes if it is current and saved after listing all headers otherwise.
+  // Files are found by name or number in index, which is read from file
+  // or built from archive headers by first lookup.
+  ArcIndex Index;
+  wchar IndexName[NM];
+  bool IndexLoaded;   // Headers are returned from index.
+  bool IndexBuild;    // Headers are added to index.
+  bool IndexSave;     // Index is saved when all headers are added.
+  bool IndexComplete; // Index contains all archive headers.
+  size_t IndexPos;    // Next index entry to return.
+  wchar ArcName[NM];  // Archive name passed to RAROpenArchiveEx.
+  int64 FirstHeadPos; // Position of header following the main header.
+
+  DataSet():Arc(&Cmd),Extract(&Cmd)
+  {
+    ReadAtReady=false;
+    *IndexName=0;
+    IndexLoaded=IndexBuild=IndexSave=IndexComplete=false;
+    IndexPos=0;
+    *ArcName=0;
+    FirstHeadPos=0;
+  };
 };
 
 
@@ -43,6 +81,17 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
     Data->OpenMode=r->OpenMode;
     Data->Cmd.FileArgs.AddString(L"*");
     Data->Cmd.KeepBroken=(r->OpFlags&ROADOF_KEEPBROKEN)!=0;
+    Data->Cmd.DllMapArchive=(r->OpFlags&ROADOF_MMAP)!=0;
+    Data->Cmd.SkipStoredHash=(r->OpFlags&ROADOF_SKIPSTOREDHASH)!=0;
+    Data->Cmd.SparseOutput=(r->OpFlags&ROADOF_SPARSE)!=0;
+    Data->Cmd.ReadNoCache=(r->OpFlags&ROADOF_READNOCACHE)!=0;
+    Data->Cmd.WriteNoCache=(r->OpFlags&ROADOF_WRITENOCACHE)!=0;
+    Data->Cmd.PreallocDest=(r->OpFlags&ROADOF_PREALLOC)!=0;
+    Data->Cmd.LazyExtra=(r->OpFlags&ROADOF_LAZYEXTRA)!=0;
+    Data->Cmd.ReadAheadSize=(size_t)Min(r->ReadAheadMB,1024)*0x100000;
+    Data->Cmd.WriteBehindSize=(size_t)Min(r->WriteBehindMB,1024)*0x100000;
+    Data->Cmd.QOpenMode=r->QOpenMode==RAR_QOPEN_NONE ? QOPEN_NONE:
+                        r->QOpenMode==RAR_QOPEN_ALWAYS ? QOPEN_ALWAYS:QOPEN_AUTO;
 
     char AnsiArcName[NM];
     *AnsiArcName=0;
@@ -71,12 +120,22 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
     // Open shared mode is added by request of dll users, who need to
     // browse and unpack archives while downloading.
     Data->Cmd.OpenShared = true;
-    if (!Data->Arc.Open(ArcName,FMF_OPENSHARED))
+    bool Opened;
+    if (r->ArcStream!=NULL)
+      Opened=Data->Arc.OpenStream(ArcName,r->ArcStream);
+    else
+      if (r->ArcData!=NULL)
+        Opened=Data->Arc.OpenMemory(ArcName,r->ArcData,r->ArcDataSize);
+      else
+        Opened=Data->Arc.Open(ArcName,FMF_OPENSHARED);
+    if (!Opened)
     {
       r->OpenResult=ERAR_EOPEN;
       delete Data;
       return NULL;
     }
+    if (Data->OpenMode==RAR_OM_LIST || Data->OpenMode==RAR_OM_LIST_INCSPLIT)
+      Data->Arc.SetHeaderReadAhead(true);
     if (!Data->Arc.IsArchive(true))
     {
       if (Data->Cmd.DllError!=0)
@@ -92,6 +151,8 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
       delete Data;
       return NULL;
     }
+    wcsncpyz(Data->ArcName,ArcName,ASIZE(Data->ArcName));
+    Data->FirstHeadPos=Data->Arc.Tell();
     r->Flags=0;
     
     if (Data->Arc.Volume)
@@ -142,6 +203,24 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
     }
     else
       r->CmtState=r->CmtSize=0;
+
+    // Index returns headers when listing archive files and finds files
+    // for RARReadHeaderByName in all modes. We do not save names from
+    // archives with encrypted headers to unencrypted index.
+    if (r->IndexNameW!=NULL && *r->IndexNameW!=0 && r->ArcStream==NULL &&
+        r->ArcData==NULL && !Data->Arc.Encrypted)
+    {
+      bool ListMode=Data->OpenMode==RAR_OM_LIST || Data->OpenMode==RAR_OM_LIST_INCSPLIT;
+      bool IncSplit=Data->OpenMode==RAR_OM_LIST_INCSPLIT;
+      wcsncpyz(Data->IndexName,r->IndexNameW,ASIZE(Data->IndexName));
+      Data->IndexComplete=Data->Index.Load(Data->IndexName,ArcName,IncSplit);
+      Data->IndexLoaded=Data->IndexComplete && ListMode;
+      if (!Data->IndexComplete && ListMode)
+      {
+        Data->IndexSave=Data->Index.Create(ArcName,IncSplit);
+        Data->IndexBuild=true;
+      }
+    }
     Data->Extract.ExtractArchiveInit(Data->Arc);
     return (HANDLE)Data;
   }
@@ -206,9 +285,53 @@ int PASCAL RARReadHeader(HANDLE hArcData,struct RARHeaderData *D)
 }
 
 
+static int ReadArcHeader(DataSet *Data,struct RARHeaderDataEx *D);
+static int ReadIndexHeader(DataSet *Data,struct RARHeaderDataEx *D);
+
+
 int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
 {
   DataSet *Data=(DataSet *)hArcData;
+  Data->ReadAtReady=false;
+  if (Data->IndexLoaded)
+    return ReadIndexHeader(Data,D);
+  int Code=ReadArcHeader(Data,D);
+  if (Data->IndexBuild)
+    if (Code==ERAR_SUCCESS)
+      Data->Index.Add(&Data->Arc.FileHead,Data->Arc.CurBlockPos);
+    else
+    {
+      // Index is complete only if we listed all headers without errors.
+      if (Code==ERAR_END_ARCHIVE)
+      {
+        Data->IndexComplete=true;
+        if (Data->IndexSave)
+          Data->Index.Save(Data->IndexName);
+      }
+      Data->IndexBuild=false;
+    }
+  return Code;
+}
+
+
+static int ReadIndexHeader(DataSet *Data,struct RARHeaderDataEx *D)
+{
+  while (Data->IndexPos<Data->Index.Count())
+  {
+    size_t Pos=Data->IndexPos++;
+    if (Data->OpenMode==RAR_OM_LIST &&
+        (Data->Index.GetEntry(Pos)->Flags & RHDF_SPLITBEFORE)!=0)
+      continue;
+    Data->Index.GetHeader(Pos,D);
+    return ERAR_SUCCESS;
+  }
+  return ERAR_END_ARCHIVE;
+}
+
+
+static int ReadArcHeader(DataSet *Data,struct RARHeaderDataEx *D)
+{
+  HANDLE hArcData=(HANDLE)Data;
   try
   {
     if ((Data->HeaderSize=(int)Data->Arc.SearchBlock(HEAD_FILE))<=0)
@@ -217,8 +340,10 @@ int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
           Data->Arc.EndArcHead.NextVolume)
         if (MergeArchive(Data->Arc,NULL,false,'L'))
         {
+          if (Data->IndexBuild && !Data->Index.AddVolume(Data->Arc.FileName))
+            Data->IndexSave=false;
           Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
-          return RARReadHeaderEx(hArcData,D);
+          return ReadArcHeader(Data,D);
         }
         else
           return ERAR_EOPEN;
@@ -238,10 +363,21 @@ int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
     {
       int Code=RARProcessFile(hArcData,RAR_SKIP,NULL,NULL);
       if (Code==0)
-        return RARReadHeaderEx(hArcData,D);
+        return ReadArcHeader(Data,D);
       else
         return Code;
     }
+    Data->ReadAtReady=true;
+    Data->ReadAtParts.Reset();
+
+    // Index file must have all fields also in ROADOF_LAZYEXTRA mode.
+    if (Data->IndexBuild && Data->IndexSave)
+      Data->Arc.ProcessLazyExtra();
+
+    // Header is only read to Arc.FileHead, like when it is added to index.
+    if (D==NULL)
+      return ERAR_SUCCESS;
+
     wcsncpy(D->ArcNameW,Data->Arc.FileName,ASIZE(D->ArcNameW));
     WideToChar(D->ArcNameW,D->ArcName,ASIZE(D->ArcName));
 
@@ -270,7 +406,7 @@ int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
     D->HostOS=hd->HSType==HSYS_WINDOWS ? HOST_WIN32:HOST_UNIX;
     D->UnpVer=Data->Arc.FileHead.UnpVer;
     D->FileCRC=hd->FileHash.CRC32;
-    D->FileTime=hd->mtime.GetDos();
+    D->FileTime=hd->mtime.IsSet() ? hd->mtime.GetDos():0;
     
     uint64 MRaw=hd->mtime.GetWin();
     D->MtimeLow=(uint)MRaw;
@@ -325,6 +461,9 @@ int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
 int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestName,wchar *DestPathW,wchar *DestNameW)
 {
   DataSet *Data=(DataSet *)hArcData;
+  Data->ReadAtReady=false;
+  if (Data->IndexLoaded) // Index entries are skipped by RARReadHeaderEx.
+    return ERAR_SUCCESS;
   try
   {
     Data->Cmd.DllError=0;
@@ -335,11 +474,16 @@ int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestNa
           Data->Arc.FileHead.SplitAfter)
         if (MergeArchive(Data->Arc,NULL,false,'L'))
         {
+          if (Data->IndexBuild && !Data->Index.AddVolume(Data->Arc.FileName))
+            Data->IndexSave=false;
           Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
           return ERAR_SUCCESS;
         }
         else
+        {
+          Data->IndexBuild=false;
           return ERAR_EOPEN;
+        }
       Data->Arc.SeekToNext();
     }
     else
@@ -387,8 +531,13 @@ int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestNa
       wcsncpyz(Data->Cmd.Command,Operation==RAR_EXTRACT ? L"X":L"T",ASIZE(Data->Cmd.Command));
       Data->Cmd.Test=Operation!=RAR_EXTRACT;
       bool Repeat=false;
+      Data->Arc.ProcessLazyExtra();
       Data->Extract.ExtractCurrentFile(Data->Arc,Data->HeaderSize,Repeat);
 
+      // Caller memory is only for the file data, not for its service headers.
+      Data->Cmd.DllUnpBuf=NULL;
+      Data->Cmd.DllUnpBufCount=0;
+
       // Now we process extra file information if any.
       //
       // Archive can be closed if we process volumes, next volume is missing
@@ -407,10 +556,12 @@ int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestNa
   }
   catch (std::bad_alloc&)
   {
+    Data->IndexBuild=false;
     return ERAR_NO_MEMORY;
   }
   catch (RAR_EXIT ErrCode)
   {
+    Data->IndexBuild=false;
     return Data->Cmd.DllError!=0 ? Data->Cmd.DllError : RarErrorToDll(ErrCode);
   }
   return Data->Cmd.DllError;
@@ -429,6 +580,458 @@ int PASCAL RARProcessFileW(HANDLE hArcData,int Operation,wchar *DestPath,wchar *
 }
 
 
+int PASCAL RARProcessFileToMemory(HANDLE hArcData,unsigned char *Buf,size_t BufSize)
+{
+  RARUnpackBuffer Buffer;
+  Buffer.Addr=Buf;
+  Buffer.Size=BufSize;
+  return RARProcessFileToMemoryV(hArcData,&Buffer,1);
+}
+
+
+// Test the current file and place its unpacked data to caller buffers,
+// filling them one after another. Buffers must hold the entire UnpSize,
+// so we do not need to call UCM_PROCESSDATA and copy data in callback.
+int PASCAL RARProcessFileToMemoryV(HANDLE hArcData,struct RARUnpackBuffer *Buffers,unsigned int BufferCount)
+{
+  DataSet *Data=(DataSet *)hArcData;
+  if (Data->OpenMode!=RAR_OM_EXTRACT) // Nothing is unpacked in list modes.
+    return ERAR_UNKNOWN;
+  FileHeader *hd=&Data->Arc.FileHead;
+
+  uint64 BufSize=0;
+  for (uint I=0;I<BufferCount;I++)
+    BufSize+=Buffers[I].Size;
+  if (hd->UnknownUnpSize || (uint64)hd->UnpSize>BufSize)
+    return ERAR_SMALL_BUF;
+
+  Data->Cmd.DllUnpBuf=Buffers;
+  Data->Cmd.DllUnpBufCount=BufferCount;
+  int Code=ProcessFile(hArcData,RAR_TEST,NULL,NULL,NULL,NULL);
+  Data->Cmd.DllUnpBuf=NULL;
+  Data->Cmd.DllUnpBufCount=0;
+  return Code;
+}
+
+
+// Find data parts of current stored file in current and following volumes.
+static int FindStoredParts(DataSet *Data)
+{
+  Archive &Arc=Data->Arc;
+  FileHeader *hd=&Arc.FileHead;
+
+  StoredPart Part;
+  wcsncpyz(Part.VolName,Arc.FileName,ASIZE(Part.VolName));
+  Part.Pos=Arc.NextBlockPos-hd->PackSize;
+  Part.Size=hd->PackSize;
+  Data->ReadAtParts.Push(Part);
+
+  bool SplitAfter=hd->SplitAfter;
+  while (SplitAfter)
+  {
+    NextVolumeName(Part.VolName,ASIZE(Part.VolName),!Arc.NewNumbering);
+    Archive VolArc(&Data->Cmd);
+    if (!VolArc.Open(Part.VolName,FMF_OPENSHARED) || !VolArc.IsArchive(false))
+      return ERAR_EOPEN;
+
+    // File continues in the first file header of next volume.
+    if (VolArc.SearchBlock(HEAD_FILE)==0 || !VolArc.FileHead.SplitBefore ||
+        wcscmp(VolArc.FileHead.FileName,hd->FileName)!=0)
+      return ERAR_BAD_DATA;
+    Part.Pos=VolArc.NextBlockPos-VolArc.FileHead.PackSize;
+    Part.Size=VolArc.FileHead.PackSize;
+    Data->ReadAtParts.Push(Part);
+    SplitAfter=VolArc.FileHead.SplitAfter;
+  }
+  return ERAR_SUCCESS;
+}
+
+
+static bool ReadFull(File *Src,byte *Buf,size_t Size)
+{
+  while (Size>0)
+  {
+    int ReadSize=Src->Read(Buf,Min(Size,0x40000000));
+    if (ReadSize<=0)
+      return false;
+    Buf+=ReadSize;
+    Size-=ReadSize;
+  }
+  return true;
+}
+
+
+// Read packed data of current stored file, which is contiguous in every
+// volume. Data in current volume is read with archive handle, keeping
+// its position. Other volumes are opened separately.
+static bool ReadStoredParts(DataSet *Data,int64 Offset,byte *Buf,size_t Size)
+{
+  for (size_t I=0;I<Data->ReadAtParts.Size() && Size>0;I++)
+  {
+    StoredPart *Part=&Data->ReadAtParts[I];
+    if (Offset>=Part->Size)
+    {
+      Offset-=Part->Size;
+      continue;
+    }
+    size_t PartSize=(size_t)Min((int64)Size,Part->Size-Offset);
+    bool Success;
+    if (wcscmp(Part->VolName,Data->Arc.FileName)==0)
+    {
+      int64 SavePos=Data->Arc.Tell();
+      Data->Arc.Seek(Part->Pos+Offset,SEEK_SET);
+      Success=ReadFull(&Data->Arc,Buf,PartSize);
+      Data->Arc.Seek(SavePos,SEEK_SET);
+    }
+    else
+    {
+      File *Vol=&Data->ReadAtVol;
+      if (!Vol->IsOpened() || wcscmp(Vol->FileName,Part->VolName)!=0)
+      {
+        Vol->Close();
+        if (!Vol->Open(Part->VolName,FMF_OPENSHARED))
+          return false;
+      }
+      Vol->Seek(Part->Pos+Offset,SEEK_SET);
+      Success=ReadFull(Vol,Buf,PartSize);
+    }
+    if (!Success)
+      return false;
+    Buf+=PartSize;
+    Size-=PartSize;
+    Offset=0;
+  }
+  return Size==0;
+}
+
+
+#ifndef RAR_NOCRYPT
+// Read and decrypt data of current stored file. In CBC mode the previous
+// encrypted block is the initialization vector of next block, so we start
+// decrypting from block preceding Offset and discard its output.
+static int ReadEncryptedParts(DataSet *Data,int64 Offset,byte *Buf,size_t Size)
+{
+  FileHeader *hd=&Data->Arc.FileHead;
+  if (!Data->Extract.ExtrDllGetPassword())
+    return ERAR_MISSING_PASSWORD;
+
+  CryptData *Crypt=&Data->ReadAtCrypt;
+  byte PswCheck[SIZE_PSWCHECK],HashKey[SHA256_DIGEST_SIZE];
+  if (!Crypt->SetCryptKeys(false,hd->CryptMethod,&Data->Cmd.Password,
+       hd->SaltSet ? hd->Salt:NULL,hd->InitV,hd->Lg2Count,HashKey,PswCheck))
+    return ERAR_MISSING_PASSWORD;
+  if (hd->UsePswCheck && memcmp(hd->PswCheck,PswCheck,SIZE_PSWCHECK)!=0)
+    return ERAR_BAD_PASSWORD;
+
+  int64 Pos=Offset & ~(int64)CRYPT_BLOCK_MASK;
+  if (Pos>0)
+  {
+    byte PrevBlock[CRYPT_BLOCK_SIZE];
+    if (!ReadStoredParts(Data,Pos-CRYPT_BLOCK_SIZE,PrevBlock,sizeof(PrevBlock)))
+      return ERAR_EREAD;
+    Crypt->DecryptBlock(PrevBlock,sizeof(PrevBlock));
+  }
+
+  Array<byte> CryptBuf(0x10000);
+  int64 EndPos=Offset+Size;
+  while (Pos<EndPos)
+  {
+    // Encrypted packed size is padded to the block size, so we can read
+    // the entire last block.
+    size_t ReadSize=(size_t)Min((int64)CryptBuf.Size(),(EndPos-Pos+CRYPT_BLOCK_MASK) & ~(int64)CRYPT_BLOCK_MASK);
+    if (!ReadStoredParts(Data,Pos,&CryptBuf[0],ReadSize))
+      return ERAR_EREAD;
+    Crypt->DecryptBlock(&CryptBuf[0],ReadSize);
+    int64 CopyPos=Max(Pos,Offset);
+    size_t CopySize=size_t(Min(Pos+(int64)ReadSize,EndPos)-CopyPos);
+    memcpy(Buf+(CopyPos-Offset),&CryptBuf[size_t(CopyPos-Pos)],CopySize);
+    Pos+=ReadSize;
+  }
+  return ERAR_SUCCESS;
+}
+#endif
+
+
+// Read any byte range of stored file, which header was returned by the last
+// RARReadHeader(Ex) call, without extracting preceding data. It can be
+// called several times before RARProcessFile. Parts of split file are
+// found in next volumes when reading the first time. Next volumes are
+// opened as files, so split files are not read from volumes in caller
+// memory or stream, which has a single read position shared with
+// the archive handle. We return ERAR_EOPEN for them instead of reading
+// files with same names, which can be unrelated to the caller data.
+int PASCAL RARReadAt(HANDLE hArcData,unsigned long long Offset,void *Buf,unsigned int Size,unsigned int *ReadSize)
+{
+  DataSet *Data=(DataSet *)hArcData;
+  *ReadSize=0;
+  if (!Data->ReadAtReady)
+    return ERAR_UNKNOWN;
+  FileHeader *hd=&Data->Arc.FileHead;
+  if (hd->Method!=0 || hd->Dir || hd->UnknownUnpSize)
+    return ERAR_UNKNOWN_FORMAT;
+  if (hd->SplitBefore) // File starts in previous volume, which is not opened.
+    return ERAR_EOPEN;
+  if (hd->SplitAfter && Data->Arc.IsCallerInput())
+    return ERAR_EOPEN;
+  if (hd->Encrypted && hd->CryptMethod!=CRYPT_RAR30 && hd->CryptMethod!=CRYPT_RAR50)
+    return ERAR_UNKNOWN_FORMAT; // No CBC mode in older encryption.
+  try
+  {
+    Data->Cmd.DllError=0;
+    if (Data->ReadAtParts.Size()==0)
+    {
+      int Code=FindStoredParts(Data);
+      if (Code!=ERAR_SUCCESS)
+      {
+        Data->ReadAtParts.Reset();
+        return Code;
+      }
+    }
+
+    if (Offset>=(uint64)hd->UnpSize)
+      return ERAR_SUCCESS;
+    size_t DataSize=(size_t)Min((uint64)Size,(uint64)hd->UnpSize-Offset);
+    if (hd->Encrypted)
+    {
+#ifdef RAR_NOCRYPT
+      return ERAR_UNKNOWN_FORMAT;
+#else
+      int Code=ReadEncryptedParts(Data,(int64)Offset,(byte *)Buf,DataSize);
+      if (Code!=ERAR_SUCCESS)
+        return Code;
+#endif
+    }
+    else
+      if (!ReadStoredParts(Data,(int64)Offset,(byte *)Buf,DataSize))
+        return ERAR_EREAD;
+    *ReadSize=(uint)DataSize;
+  }
+  catch (std::bad_alloc&)
+  {
+    return ERAR_NO_MEMORY;
+  }
+  catch (RAR_EXIT ErrCode)
+  {
+    return Data->Cmd.DllError!=0 ? Data->Cmd.DllError : RarErrorToDll(ErrCode);
+  }
+  return ERAR_SUCCESS;
+}
+
+
+// Open archive volume if it is not current and seek to header position.
+// Scan is true if all following headers are read.
+static bool SeekToHeader(DataSet *Data,const wchar *VolName,int64 HeadPos,bool Scan)
+{
+  Archive &Arc=Data->Arc;
+  if (wcscmp(Arc.FileName,VolName)!=0)
+  {
+    Arc.Close();
+    if (!Arc.Open(VolName,FMF_OPENSHARED) || !Arc.IsArchive(false))
+      return false;
+  }
+
+  // Quick open data is read sequentially up to the requested position,
+  // which is much slower than reading a header with known position.
+  if (!Scan && Data->Cmd.QOpenMode!=QOPEN_ALWAYS)
+    Arc.QOpenUnload();
+  Arc.Seek(HeadPos,SEEK_SET);
+  return true;
+}
+
+
+// Read all archive headers to index, so we can find files by name
+// or number. Index file is saved if it was requested when opening.
+static int ScanHeaders(DataSet *Data)
+{
+  Archive &Arc=Data->Arc;
+  Data->IndexSave=Data->Index.Create(Data->ArcName,true) && *Data->IndexName!=0;
+  Data->IndexBuild=true;
+  if (!SeekToHeader(Data,Data->ArcName,Data->FirstHeadPos,true))
+  {
+    Data->IndexBuild=false;
+    return ERAR_EOPEN;
+  }
+
+  // We read headers of all split file parts and do not unpack anything,
+  // same as when listing in RAR_OM_LIST_INCSPLIT mode.
+  int OpenMode=Data->OpenMode;
+  bool ListMode=OpenMode==RAR_OM_LIST || OpenMode==RAR_OM_LIST_INCSPLIT;
+  Data->OpenMode=RAR_OM_LIST_INCSPLIT;
+  if (!ListMode)
+    Arc.SetHeaderReadAhead(true);
+
+  int Code;
+  while ((Code=ReadArcHeader(Data,NULL))==ERAR_SUCCESS)
+  {
+    Data->Index.Add(&Arc.FileHead,Arc.CurBlockPos);
+    if ((Code=ProcessFile((HANDLE)Data,RAR_SKIP,NULL,NULL,NULL,NULL))!=ERAR_SUCCESS)
+      break;
+  }
+
+  if (!ListMode)
+    Arc.SetHeaderReadAhead(false);
+  Data->OpenMode=OpenMode;
+  Data->IndexBuild=false;
+  if (Code!=ERAR_END_ARCHIVE)
+    return Code;
+  Data->IndexComplete=true;
+  if (Data->IndexSave)
+    Data->Index.Save(Data->IndexName);
+  return ERAR_SUCCESS;
+}
+
+
+// First file of solid group containing index entry. RAR 1.5 files do not
+// have the solid flag, so the entire solid archive is one group for them.
+static size_t SolidGroupStart(ArcIndex *Index,size_t Pos)
+{
+  if (Index->GetEntry(Pos)->UnpVer<20)
+    return 0;
+  while (Pos>0 && (Index->GetEntry(Pos)->Flags & (RHDF_SOLID|RHDF_SPLITBEFORE))!=0)
+    Pos--;
+  return Pos;
+}
+
+
+// Read header of index entry from archive, so RARProcessFile and RARReadAt
+// process this file next. To extract a file from solid archive, we unpack
+// preceding files of its solid group, unless archive is positioned
+// at one of them already, like after extracting the previous file.
+static int ReadHeaderAt(DataSet *Data,size_t Pos,struct RARHeaderDataEx *D)
+{
+  Archive &Arc=Data->Arc;
+  ArcIndex *Index=&Data->Index;
+  size_t Start=Pos,Next;
+  bool Continue=false;
+  if (Data->OpenMode==RAR_OM_EXTRACT && Arc.Solid)
+  {
+    Start=SolidGroupStart(Index,Pos);
+    Continue=Index->FindHeader(Arc.FileName,Arc.Tell(),&Next) && Next>=Start && Next<=Pos;
+  }
+  if (!Continue)
+  {
+    wchar VolName[NM];
+    Index->GetVolumeName(Start,VolName,ASIZE(VolName));
+    if (!SeekToHeader(Data,VolName,Index->GetEntry(Start)->HeadPos,false))
+      return ERAR_EOPEN;
+    if (Data->OpenMode==RAR_OM_EXTRACT)
+      Data->Extract.ExtractArchiveInit(Arc);
+  }
+
+  while (true)
+  {
+    int Code=ReadArcHeader(Data,D);
+    if (Code!=ERAR_SUCCESS) // Archive does not match the index.
+      return Code==ERAR_END_ARCHIVE ? ERAR_BAD_DATA:Code;
+    if (!Index->FindHeader(Arc.FileName,Arc.CurBlockPos,&Next) || Next>Pos)
+      return ERAR_BAD_DATA;
+    if (Next==Pos)
+      return ERAR_SUCCESS;
+    if ((Code=ProcessFile((HANDLE)Data,RAR_SKIP,NULL,NULL,NULL,NULL))!=ERAR_SUCCESS)
+      return Code;
+  }
+}
+
+
+// Find file by name if FileName is not NULL or by number otherwise.
+// If archive headers are not indexed yet, they are read to index first.
+static int ReadFoundHeader(DataSet *Data,const wchar *FileName,uint Number,struct RARHeaderDataEx *D)
+{
+  Data->ReadAtReady=false;
+  try
+  {
+    Data->Cmd.DllError=0;
+
+    // Files preceding a damaged header can be found, but we read headers
+    // again for every lookup in such archive.
+    int ScanCode=ERAR_SUCCESS;
+    if (!Data->IndexComplete)
+      ScanCode=ScanHeaders(Data);
+
+    size_t Pos;
+    bool Found=FileName!=NULL ? Data->Index.FindName(FileName,&Pos):Data->Index.FindFile(Number,&Pos);
+    if (!Found)
+      return ScanCode!=ERAR_SUCCESS ? ScanCode:ERAR_END_ARCHIVE;
+    if (Data->IndexLoaded)
+    {
+      Data->Index.GetHeader(Pos,D);
+      Data->IndexPos=Pos+1;
+      return ERAR_SUCCESS;
+    }
+    return ReadHeaderAt(Data,Pos,D);
+  }
+  catch (std::bad_alloc&)
+  {
+    return ERAR_NO_MEMORY;
+  }
+  catch (RAR_EXIT ErrCode)
+  {
+    return Data->Cmd.DllError!=0 ? Data->Cmd.DllError : RarErrorToDll(ErrCode);
+  }
+}
+
+
+// Read header of file with specified name, same as RARReadHeaderEx
+// does for the next file. Unless a current index file was loaded,
+// the first lookup on handle reads headers of all volumes to index,
+// so a single lookup is faster with RARReadHeaderEx loop.
+// Returns ERAR_END_ARCHIVE if there is no such file.
+int PASCAL RARReadHeaderByName(HANDLE hArcData,const wchar_t *FileName,struct RARHeaderDataEx *D)
+{
+  return ReadFoundHeader((DataSet *)hArcData,FileName,0,D);
+}
+
+
+// Read header of file with specified number, starting from 0, in order
+// of RAR_OM_LIST listing, where continued parts of split files are skipped.
+int PASCAL RARReadHeaderByIndex(HANDLE hArcData,unsigned int Index,struct RARHeaderDataEx *D)
+{
+  return ReadFoundHeader((DataSet *)hArcData,NULL,Index,D);
+}
+
+
+// Return headers of all files in one memory block, which must be freed
+// with RARFreeList. Headers are read from index if it is current.
+// Continued headers of split files are included only in
+// RAR_OM_LIST_INCSPLIT mode. If reading headers fails, headers preceding
+// the error are returned together with error code and RARReadHeaderEx
+// continues from the damaged header. Use RARReadHeaderByName or
+// RARReadHeaderByIndex to process a listed file, RARReadHeaderEx
+// does not continue after it.
+int PASCAL RARListAll(HANDLE hArcData,struct RARList **List)
+{
+  DataSet *Data=(DataSet *)hArcData;
+  *List=NULL;
+  Data->ReadAtReady=false;
+  try
+  {
+    Data->Cmd.DllError=0;
+    int Code=ERAR_SUCCESS;
+    if (!Data->IndexComplete)
+      Code=ScanHeaders(Data);
+    if ((*List=Data->Index.GetList(Data->OpenMode==RAR_OM_LIST_INCSPLIT))==NULL)
+      return ERAR_NO_MEMORY;
+    if (Data->IndexLoaded)
+      Data->IndexPos=Data->Index.Count();
+    return Code;
+  }
+  catch (std::bad_alloc&)
+  {
+    return ERAR_NO_MEMORY;
+  }
+  catch (RAR_EXIT ErrCode)
+  {
+    return Data->Cmd.DllError!=0 ? Data->Cmd.DllError : RarErrorToDll(ErrCode);
+  }
+}
+
+
+void PASCAL RARFreeList(struct RARList *List)
+{
+  free(List);
+}
+
+
 void PASCAL RARSetChangeVolProc(HANDLE hArcData,CHANGEVOLPROC ChangeVolProc)
 {
   DataSet *Data=(DataSet *)hArcData;
@@ -469,6 +1072,15 @@ int PASCAL RARGetDllVersion()
 }
 
 
+// Set the maximum total size of unpack buffers kept by closed archives
+// for reuse by archives opened later. 0 disables caching and releases
+// all currently cached buffers.
+void PASCAL RARSetUnpackPoolSize(unsigned int MaxSizeMB)
+{
+  UnpBufPool.SetLimit(MaxSizeMB>(size_t(-1)>>20) ? size_t(-1) : size_t(MaxSizeMB)<<20);
+}
+
+
 static int RarErrorToDll(RAR_EXIT ErrCode)
 {
   switch(ErrCode)
@@ -37,6 +37,10 @@
 #define RAR_HASH_CRC32        1
 #define RAR_HASH_BLAKE2       2
 
+#define RAR_QOPEN_AUTO        0
+#define RAR_QOPEN_NONE        1
+#define RAR_QOPEN_ALWAYS      2
+
 
 #ifdef _UNIX
 #define CALLBACK
@@ -136,6 +140,36 @@ typedef int (CALLBACK *UNRARCALLBACK)(UINT msg,LPARAM UserData,LPARAM P1,LPARAM
 #define ROADF_FIRSTVOLUME  0x0100
 
 #define ROADOF_KEEPBROKEN  0x0001
+#define ROADOF_MMAP        0x0002 // Read archive files through memory mapping.
+#define ROADOF_SKIPSTOREDHASH 0x0004 // Do not verify checksums of stored files.
+#define ROADOF_SPARSE      0x0008 // Extract zero blocks as holes in files.
+#define ROADOF_READNOCACHE 0x0010 // Drop read archive data from page cache.
+#define ROADOF_WRITENOCACHE 0x0020 // Drop extracted data from page cache.
+#define ROADOF_PREALLOC    0x0040 // Preallocate extracted files.
+// RAR5 file times, hash and link are 0 in headers read with ROADOF_LAZYEXTRA,
+// unless headers come from index file or are saved to it. They cannot be
+// decoded later, open another handle without this flag to get them.
+// Extraction and testing still set file times and verify hashes.
+#define ROADOF_LAZYEXTRA   0x0080 // Do not return RAR5 times, hash and link.
+
+// Archive input callbacks. Read returns the number of read bytes, 0 at
+// the end of data or -1 on error. Seek sets the absolute read position,
+// Size returns the volume size. They return -1 on error. OpenVolume
+// switches the stream to another volume and returns -1 if it is missing.
+typedef int (CALLBACK *RARSTREAMREAD)(LPARAM UserData,void *Buf,unsigned int Size);
+typedef int (CALLBACK *RARSTREAMSEEK)(LPARAM UserData,long long Pos);
+typedef long long (CALLBACK *RARSTREAMSIZE)(LPARAM UserData);
+typedef int (CALLBACK *RARSTREAMOPENVOLUME)(LPARAM UserData,const wchar_t *VolName);
+
+struct RARArchiveStream
+{
+  LPARAM              UserData;
+  RARSTREAMREAD       Read;
+  RARSTREAMSEEK       Seek;
+  RARSTREAMSIZE       Size;
+  RARSTREAMOPENVOLUME OpenVolume;
+  unsigned int        Reserved[16];
+};
 
 struct RAROpenArchiveDataEx
 {
@@ -152,7 +186,14 @@ struct RAROpenArchiveDataEx
   LPARAM        UserData;
   unsigned int  OpFlags;
   wchar_t      *CmtBufW;
-  unsigned int  Reserved[25];
+  void         *ArcData;
+  size_t        ArcDataSize;
+  struct RARArchiveStream *ArcStream;
+  unsigned int  ReadAheadMB; // Read packed data ahead in background thread.
+  unsigned int  WriteBehindMB; // Write unpacked data in background thread.
+  wchar_t      *IndexNameW; // Header index file for listing and lookups.
+  unsigned int  QOpenMode; // Read headers from quick open data, RAR_QOPEN_*.
+  unsigned int  Reserved[14];
 };
 
 enum UNRARCALLBACK_MESSAGES {
@@ -160,6 +201,48 @@ enum UNRARCALLBACK_MESSAGES {
   UCM_NEEDPASSWORDW
 };
 
+struct RARUnpackBuffer
+{
+  unsigned char *Addr;
+  size_t         Size;
+};
+
+// Header returned by RARListAll. Names are offsets of zero terminated
+// UTF-8 strings in RARList Names pool.
+struct RARListEntry
+{
+  unsigned long long PackSize;
+  unsigned long long UnpSize;
+  unsigned long long Mtime;
+  unsigned long long Ctime;
+  unsigned long long Atime;
+  unsigned int       FileName;
+  unsigned int       ArcName;
+  unsigned int       RedirName;
+  unsigned int       Flags;
+  unsigned int       FileCRC;
+  unsigned int       FileTime;
+  unsigned int       FileAttr;
+  unsigned int       DictSize;
+  unsigned char      HostOS;
+  unsigned char      UnpVer;
+  unsigned char      Method;
+  unsigned char      HashType;
+  unsigned char      RedirType;
+  unsigned char      DirTarget;
+  unsigned char      Reserved[2];
+  unsigned char      Hash[32];
+};
+
+struct RARList
+{
+  struct RARListEntry *Entries;
+  unsigned int         EntryCount;
+  char                *Names;
+  unsigned int         NamesSize;
+  unsigned int         Reserved[8];
+};
+
 typedef int (PASCAL *CHANGEVOLPROC)(char *ArcName,int Mode);
 typedef int (PASCAL *PROCESSDATAPROC)(unsigned char *Addr,int Size);
 
@@ -172,13 +255,24 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *ArchiveData);
 int    PASCAL RARCloseArchive(HANDLE hArcData);
 int    PASCAL RARReadHeader(HANDLE hArcData,struct RARHeaderData *HeaderData);
 int    PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *HeaderData);
+int    PASCAL RARReadHeaderByName(HANDLE hArcData,const wchar_t *FileName,struct RARHeaderDataEx *HeaderData);
+int    PASCAL RARReadHeaderByIndex(HANDLE hArcData,unsigned int Index,struct RARHeaderDataEx *HeaderData);
+int    PASCAL RARListAll(HANDLE hArcData,struct RARList **List);
+void   PASCAL RARFreeList(struct RARList *List);
 int    PASCAL RARProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestName);
 int    PASCAL RARProcessFileW(HANDLE hArcData,int Operation,wchar_t *DestPath,wchar_t *DestName);
+int    PASCAL RARProcessFileToMemory(HANDLE hArcData,unsigned char *Buf,size_t BufSize);
+int    PASCAL RARProcessFileToMemoryV(HANDLE hArcData,struct RARUnpackBuffer *Buffers,unsigned int BufferCount);
+// RARReadAt returns ERAR_EOPEN for stored files split after the current
+// volume, if it is read from ArcData memory or ArcStream. Their next volumes
+// can be read only from files, which may be unrelated to caller data.
+int    PASCAL RARReadAt(HANDLE hArcData,unsigned long long Offset,void *Buf,unsigned int Size,unsigned int *ReadSize);
 void   PASCAL RARSetCallback(HANDLE hArcData,UNRARCALLBACK Callback,LPARAM UserData);
 void   PASCAL RARSetChangeVolProc(HANDLE hArcData,CHANGEVOLPROC ChangeVolProc);
 void   PASCAL RARSetProcessDataProc(HANDLE hArcData,PROCESSDATAPROC ProcessDataProc);
 void   PASCAL RARSetPassword(HANDLE hArcData,char *Password);
 int    PASCAL RARGetDllVersion();
+void   PASCAL RARSetUnpackPoolSize(unsigned int MaxSizeMB);
 
 #ifdef __cplusplus
 }
@@ -540,6 +540,10 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
 #endif
 
     File CurFile;
+    CurFile.SetNoCache(Cmd->WriteNoCache);
+#ifdef RAR_SMP
+    WriteBehindScope WriteScope(&DataIO);
+#endif
 
     bool LinkEntry=Arc.FileHead.RedirType!=FSREDIR_NONE;
     if (LinkEntry && Arc.FileHead.RedirType!=FSREDIR_FILECOPY)
@@ -628,12 +632,16 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
 
       DataIO.CurUnpRead=0;
       DataIO.CurUnpWrite=0;
+      DataIO.UnpHashSkipped=false;
       DataIO.UnpHash.Init(Arc.FileHead.FileHash.Type,Cmd->Threads);
       DataIO.PackedDataHash.Init(Arc.FileHead.FileHash.Type,Cmd->Threads);
       DataIO.SetPackedSizeToRead(Arc.FileHead.PackSize);
       DataIO.SetFiles(&Arc,&CurFile);
       DataIO.SetTestMode(TestMode);
       DataIO.SetSkipUnpCRC(SkipSolid);
+#ifdef RARDLL
+      DataIO.SetUnpackToMemory(Cmd->DllUnpBuf,SkipSolid ? 0:Cmd->DllUnpBufCount);
+#endif
 
 #if defined(_WIN_ALL) && !defined(SFX_MODULE) && !defined(SILENT)
       if (!TestMode && !Arc.BrokenHeader &&
@@ -646,8 +654,16 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
       }
 #endif
 
+      // Preallocated space would be used instead of holes in sparse mode.
+      // Unix file systems allocate space well without it, so there it is
+      // done only if requested.
+#ifdef _UNIX
+      bool PreallocDest=Cmd->PreallocDest;
+#else
+      bool PreallocDest=true;
+#endif
       uint64 Preallocated=0;
-      if (!TestMode && !Arc.BrokenHeader && Arc.FileHead.UnpSize>1000000 &&
+      if (!TestMode && !Arc.BrokenHeader && PreallocDest && !Cmd->SparseOutput && Arc.FileHead.UnpSize>1000000 &&
           Arc.FileHead.PackSize*1024>Arc.FileHead.UnpSize && Arc.IsSeekable() &&
           (Arc.FileHead.UnpSize<100000000 || Arc.FileLength()>Arc.FileHead.PackSize))
       {
@@ -655,6 +671,8 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
         Preallocated=Arc.FileHead.UnpSize;
       }
       CurFile.SetAllowDelete(!Cmd->KeepBroken);
+      if (Cmd->SparseOutput && !TestMode)
+        CurFile.SetSparseWrite(true);
 
       bool FileCreateMode=!TestMode && !SkipSolid && Command!='P';
       bool ShowChecksum=true; // Display checksum verification result.
@@ -715,6 +733,9 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
 #endif
               Unp->DoUnpack(Arc.FileHead.UnpVer,Arc.FileHead.Solid);
           }
+#ifdef RAR_SMP
+      DataIO.FinishWrite();
+#endif
 
       Arc.SeekToNext();
 
@@ -724,7 +745,8 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
       // to prevent accidental match. Moreover, for -m0 volumes packed data
       // hash would match truncated unpacked data hash and lead to fake "OK"
       // in incomplete volume set.
-      bool ValidCRC=!Arc.FileHead.SplitAfter && DataIO.UnpHash.Cmp(&Arc.FileHead.FileHash,Arc.FileHead.UseHashKey ? Arc.FileHead.HashKey:NULL);
+      bool ValidCRC=!Arc.FileHead.SplitAfter && (DataIO.UnpHashSkipped ||
+           DataIO.UnpHash.Cmp(&Arc.FileHead.FileHash,Arc.FileHead.UseHashKey ? Arc.FileHead.HashKey:NULL));
 
       // We set AnySolidDataUnpackedWell to true if we found at least one
       // valid non-zero solid file in preceding solid stream. If it is true
@@ -745,7 +767,7 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
         {
           if (Command!='P' && Command!='I' && !Cmd->DisableNames)
             mprintf(L"%s%s ",Cmd->DisablePercentage ? L" ":L"\b\b\b\b\b ",
-              Arc.FileHead.FileHash.Type==HASH_NONE ? L"  ?":St(MOk));
+              Arc.FileHead.FileHash.Type==HASH_NONE || DataIO.UnpHashSkipped ? L"  ?":St(MOk));
         }
         else
         {
@@ -796,6 +818,7 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
           // or file with crafted header.
           if (Preallocated>0 && (BrokenFile || DataIO.CurUnpWrite!=Preallocated))
             CurFile.Truncate();
+          CurFile.FinishSparse();
 
 
           CurFile.SetOpenFileTime(
@@ -850,6 +873,11 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
 
 void CmdExtract::UnstoreFile(ComprDataIO &DataIO,int64 DestUnpSize)
 {
+#ifdef USE_COPY_RANGE
+  DestUnpSize-=DataIO.CopyStoredData(DestUnpSize);
+  if (DataIO.NextVolumeMissing)
+    return;
+#endif
   Array<byte> Buffer(File::CopyBufferSize());
   while (true)
   {
@@ -9,9 +9,7 @@ class CmdExtract
     EXTRACT_ARC_CODE ExtractArchive();
     bool ExtractFileCopy(File &New,wchar *ArcName,wchar *NameNew,wchar *NameExisting,size_t NameExistingSize);
     void ExtrPrepareName(Archive &Arc,const wchar *ArcFileName,wchar *DestName,size_t DestSize);
-#ifdef RARDLL
-    bool ExtrDllGetPassword();
-#else
+#ifndef RARDLL
     bool ExtrGetPassword(Archive &Arc,const wchar *ArcFileName);
 #endif
 #if defined(_WIN_ALL) && !defined(SFX_MODULE)
@@ -62,6 +60,9 @@ class CmdExtract
     void ExtractArchiveInit(Archive &Arc);
     bool ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat);
     static void UnstoreFile(ComprDataIO &DataIO,int64 DestUnpSize);
+#ifdef RARDLL
+    bool ExtrDllGetPassword();
+#endif
 };
 
 #endif
@@ -20,6 +20,11 @@ File::File()
   ReadErrorMode=FREM_ASK;
   TruncatedAfterReadError=false;
   CurFilePos=0;
+  SparseWrite=false;
+  HoleAtEnd=false;
+  NoCache=false;
+  CacheWrite=false;
+  DropPos=FlushPos=0;
 }
 
 
@@ -150,6 +155,8 @@ bool File::Open(const wchar *Name,uint Mode)
     hFile=hNewFile;
     wcsncpyz(FileName,Name,ASIZE(FileName));
     TruncatedAfterReadError=false;
+    if (NoCache)
+      SetCacheHints(UpdateMode || WriteMode);
   }
   return Success;
 }
@@ -216,6 +223,8 @@ bool File::Create(const wchar *Name,uint Mode)
   HandleType=FILE_HANDLENORMAL;
   SkipClose=false;
   wcsncpyz(FileName,Name,ASIZE(FileName));
+  if (NoCache && hFile!=FILE_BAD_HANDLE)
+    SetCacheHints(true);
   return hFile!=FILE_BAD_HANDLE;
 }
 
@@ -244,6 +253,8 @@ bool File::Close()
 
   if (hFile!=FILE_BAD_HANDLE)
   {
+    if (NoCache && !SkipClose && HandleType==FILE_HANDLENORMAL)
+      DropCache(true);
     if (!SkipClose)
     {
 #ifdef _WIN_ALL
@@ -299,6 +310,19 @@ bool File::Write(const void *Data,size_t Size)
 {
   if (Size==0)
     return true;
+  bool Success;
+  if (SparseWrite && HandleType==FILE_HANDLENORMAL)
+    Success=WriteSparse((const byte *)Data,Size);
+  else
+    Success=WriteData(Data,Size);
+  if (NoCache && Success)
+    DropCache(false);
+  return Success;
+}
+
+
+bool File::WriteData(const void *Data,size_t Size)
+{
   if (HandleType==FILE_HANDLESTD)
   {
 #ifdef _WIN_ALL
@@ -371,6 +395,134 @@ bool File::Write(const void *Data,size_t Size)
 }
 
 
+// Write data except zero blocks aligned to FILE_SPARSE_BLOCK in file.
+// We seek over skipped blocks, creating holes in file if they are
+// followed by data. Caller must call FinishSparse to set the length
+// of file ending with skipped blocks.
+bool File::WriteSparse(const byte *Data,size_t Size)
+{
+  int64 Pos=Tell();
+  size_t DataStart=0; // Start of data not written yet.
+  bool Skipped=false; // Data start follows skipped blocks.
+  for (size_t I=0;I<Size;)
+  {
+    size_t BlockSize=FILE_SPARSE_BLOCK-size_t((Pos+I)%FILE_SPARSE_BLOCK);
+    if (BlockSize>Size-I)
+      break;
+    if (Data[I]==0 && memcmp(Data+I,Data+I+1,BlockSize-1)==0)
+    {
+      if (I>DataStart)
+      {
+        if (Skipped)
+          Seek(Pos+DataStart,SEEK_SET);
+        if (!WriteData(Data+DataStart,I-DataStart))
+          return false;
+      }
+      DataStart=I+BlockSize;
+      Skipped=true;
+    }
+    I+=BlockSize;
+  }
+  if (Skipped)
+    Seek(Pos+DataStart,SEEK_SET);
+  HoleAtEnd=DataStart==Size;
+  if (!HoleAtEnd)
+    return WriteData(Data+DataStart,Size-DataStart);
+  return true;
+}
+
+
+// Write mode skipping zero blocks, see WriteSparse.
+void File::SetSparseWrite(bool Mode)
+{
+#ifdef _WIN_ALL
+  // Without this attribute NTFS allocates and fills skipped blocks.
+  DWORD BytesReturned;
+  if (Mode && hFile!=FILE_BAD_HANDLE)
+    DeviceIoControl(hFile,FSCTL_SET_SPARSE,NULL,0,NULL,0,&BytesReturned,NULL);
+#endif
+  SparseWrite=Mode;
+  HoleAtEnd=false;
+}
+
+
+// Set hints for file opened in no cache mode. Data is dropped from page
+// cache by DropCache in Linux, where we can do it for file ranges, and
+// not cached at all in macOS and iOS.
+void File::SetCacheHints(bool Write)
+{
+  CacheWrite=Write;
+  DropPos=FlushPos=0;
+#ifdef _UNIX
+  int fd=GetFD();
+#ifdef __APPLE__
+  fcntl(fd,F_NOCACHE,1);
+#elif defined(POSIX_FADV_SEQUENTIAL)
+  if (!Write)
+  {
+    posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd,0,0,POSIX_FADV_NOREUSE);
+  }
+#endif
+#endif
+}
+
+
+// Drop data preceding the current position from page cache in no cache
+// mode, so large extraction does not evict cached data of other processes.
+// Written data must be on disk before it can be dropped. So we start
+// writing every new block and wait for the previous one, letting the disk
+// write in background while we unpack. If Final is true, we wait for
+// and drop all data.
+void File::DropCache(bool Final)
+{
+#if defined(__linux) && defined(POSIX_FADV_DONTNEED)
+  if (!NoCache || hFile==FILE_BAD_HANDLE)
+    return;
+  int fd=GetFD();
+  int64 Pos=File::Tell();
+  if (Pos<FlushPos) // Seek back, such as to read the next header.
+  {
+    if (Pos<DropPos)
+      DropPos=Pos;
+    FlushPos=Pos;
+    if (!Final)
+      return;
+  }
+  if (!Final && Pos-FlushPos<FILE_NOCACHE_BLOCK)
+    return;
+  if (CacheWrite && Pos>FlushPos)
+    sync_file_range(fd,FlushPos,Pos-FlushPos,SYNC_FILE_RANGE_WRITE);
+
+  // Page cache can use large folios, which are kept if range covers them
+  // only partially. So we drop aligned blocks and the rest of file
+  // in the end. Written data is dropped after previous sync completes.
+  int64 DropStart=DropPos & ~(int64)(FILE_NOCACHE_BLOCK-1);
+  int64 DropEnd=(CacheWrite ? FlushPos:Pos) & ~(int64)(FILE_NOCACHE_BLOCK-1);
+  if (Final || DropEnd>DropStart)
+  {
+    int64 Length=Final ? 0:DropEnd-DropStart; // 0 is up to end of file.
+    if (CacheWrite)
+      sync_file_range(fd,DropStart,Length,SYNC_FILE_RANGE_WAIT_BEFORE|
+                      SYNC_FILE_RANGE_WRITE|SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(fd,DropStart,Length,POSIX_FADV_DONTNEED);
+    DropPos=Final ? Pos:DropEnd;
+  }
+  FlushPos=Pos;
+#endif
+}
+
+
+// Set file length if last sparse write skipped blocks at end of file.
+bool File::FinishSparse()
+{
+  if (!HoleAtEnd)
+    return true;
+  HoleAtEnd=false;
+  return Truncate();
+}
+
+
 int File::Read(void *Data,size_t Size)
 {
   if (TruncatedAfterReadError)
@@ -440,6 +592,8 @@ int File::Read(void *Data,size_t Size)
   }
   if (TotalRead>0) // Can be -1 for error and AllowExceptions disabled.
     CurFilePos+=TotalRead;
+  if (NoCache && TotalRead>0)
+    DropCache(false);
   return TotalRead; // It can return -1 only if AllowExceptions is disabled.
 }
 
@@ -620,6 +774,17 @@ void File::Prealloc(int64 Size)
   if (fd >= 0)
     fallocate(fd, 0, 0, Size);
 #endif
+
+#if defined(_UNIX) && defined(__APPLE__)
+  // Allocate contiguous space if possible. It does not change file size.
+  fstore_t Store={F_ALLOCATECONTIG,F_PEOFPOSMODE,0,(off_t)Size,0};
+  int fd=GetFD();
+  if (fd>=0 && fcntl(fd,F_PREALLOCATE,&Store)==-1)
+  {
+    Store.fst_flags=F_ALLOCATEALL;
+    fcntl(fd,F_PREALLOCATE,&Store);
+  }
+#endif
 }
 
 
@@ -18,6 +18,14 @@ class RAROptions;
 
 enum FILE_HANDLETYPE {FILE_HANDLENORMAL,FILE_HANDLESTD};
 
+// Zero blocks of this size, aligned in file, are not written in sparse
+// write mode, so file system can leave holes instead of them.
+#define FILE_SPARSE_BLOCK 0x10000
+
+// Read or written data is dropped from page cache in blocks of this size
+// in no cache mode.
+#define FILE_NOCACHE_BLOCK 0x800000
+
 enum FILE_ERRORTYPE {FILE_SUCCESS,FILE_NOTFOUND,FILE_READERROR};
 
 enum FILE_MODE_FLAGS {
@@ -82,6 +90,18 @@ class File
     bool TruncatedAfterReadError;
 
     int64 CurFilePos; // Used for forward seeks in stdin files.
+
+    bool SparseWrite; // Skip zero blocks in Write, leaving holes in file.
+    bool HoleAtEnd;   // Last Write skipped zero blocks at end of its data.
+
+    bool NoCache;     // Drop read or written data from page cache.
+    bool CacheWrite;  // File is opened for writing in no cache mode.
+    int64 DropPos;    // Data before this position is dropped from cache.
+    int64 FlushPos;   // Data before this position is being written to disk.
+
+    bool WriteData(const void *Data,size_t Size);
+    bool WriteSparse(const byte *Data,size_t Size);
+    void SetCacheHints(bool Write);
   protected:
     bool OpenShared; // Set by 'Archive' class.
   public:
@@ -134,6 +154,11 @@ class File
     void SetAllowDelete(bool Allow) {AllowDelete=Allow;}
     void SetExceptions(bool Allow) {AllowExceptions=Allow;}
     void SetPreserveAtime(bool Preserve) {PreserveAtime=Preserve;}
+    void SetSparseWrite(bool Mode);
+    bool IsSparseWrite() {return SparseWrite;}
+    void SetNoCache(bool Mode) {NoCache=Mode;}
+    void DropCache(bool Final);
+    bool FinishSparse();
     bool IsTruncatedAfterReadError() {return TruncatedAfterReadError;}
 #ifdef _UNIX
     int GetFD()
@@ -29,28 +29,29 @@ class BitInput
       InBit=Bits&7;
     }
     
+    // Return 64 bits from current position in the buffer. Only 57 upper
+    // bits are guaranteed to be valid, lower bits can be garbage.
+    // Bit at (InAddr,InBit) has the highest position in returning data.
+    // We fill the entire container with a single unaligned load, so it is
+    // cheaper than assembling shorter fields byte by byte. The buffer must
+    // have at least 8 readable bytes at InAddr.
+    uint64 getbits64()
+    {
+      return RawGetBE8(InBuf+InAddr) << InBit;
+    }
+
     // Return 16 bits from current position in the buffer.
     // Bit at (InAddr,InBit) has the highest position in returning data.
     uint getbits()
     {
-      uint BitField=(uint)InBuf[InAddr] << 16;
-      BitField|=(uint)InBuf[InAddr+1] << 8;
-      BitField|=(uint)InBuf[InAddr+2];
-      BitField >>= (8-InBit);
-      return BitField & 0xffff;
+      return uint(getbits64() >> 48);
     }
 
     // Return 32 bits from current position in the buffer.
     // Bit at (InAddr,InBit) has the highest position in returning data.
     uint getbits32()
     {
-      uint BitField=(uint)InBuf[InAddr] << 24;
-      BitField|=(uint)InBuf[InAddr+1] << 16;
-      BitField|=(uint)InBuf[InAddr+2] << 8;
-      BitField|=(uint)InBuf[InAddr+3];
-      BitField <<= InBit;
-      BitField|=(uint)InBuf[InAddr+4] >> (8-InBit);
-      return BitField & 0xffffffff;
+      return uint(getbits64() >> 32);
     }
     
     void faddbits(uint Bits);
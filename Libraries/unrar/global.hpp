@@ -9,6 +9,8 @@
 
 EXTVAR ErrorHandler ErrHandler;
 
+EXTVAR UnpackBufferPool UnpBufPool;
+
 
 
 #endif
@@ -24,6 +24,7 @@ void ListArchive(CommandData *Cmd)
     Archive Arc(Cmd);
     if (!Arc.WOpen(ArcName))
       continue;
+    Arc.SetHeaderReadAhead(true);
     bool FileMatched=true;
     while (true)
     {
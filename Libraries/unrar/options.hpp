@@ -204,6 +204,14 @@ class RAROptions
     wchar UseStdin[NM];
 
     uint Threads; // We use it to init hash even if RAR_SMP is not defined.
+    size_t ReadAheadSize; // Packed data read in background, 0 to disable.
+    size_t WriteBehindSize; // Unpacked data written in background, 0 to disable.
+    bool SkipStoredHash; // Do not verify checksums of directly copied stored files.
+    bool SparseOutput; // Leave holes for zero blocks in extracted files.
+    bool ReadNoCache; // Drop read archive data from page cache.
+    bool WriteNoCache; // Drop written data of extracted files from page cache.
+    bool PreallocDest; // Preallocate extracted files in Unix.
+    bool LazyExtra; // Decode RAR5 file times, hash and link only when needed.
 
 
 
@@ -217,6 +225,13 @@ class RAROptions
     UNRARCALLBACK Callback;
     CHANGEVOLPROC ChangeVolProc;
     PROCESSDATAPROC ProcessDataProc;
+
+    // Caller memory to unpack the current file to.
+    RARUnpackBuffer *DllUnpBuf;
+    uint DllUnpBufCount;
+
+    // Read archive volumes through memory mapping.
+    bool DllMapArchive;
 #endif
 };
 #endif
@@ -141,6 +141,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#ifdef __linux
+  #include <sys/sendfile.h>
+  #define USE_COPY_RANGE // Copy stored file data in kernel.
+  #define USE_FALLOCATE
+#endif
 #if defined(__QNXNTO__)
   #include <sys/param.h>
 #endif
@@ -232,6 +239,12 @@
   #define SSE_ALIGNMENT 1
 #endif
 
+// SSE2 and AVX2 versions of RAR5 filters are selected at runtime and do not
+// require SSE compiler switches, so we can use them in all x86 builds.
+#if defined(USE_SSE) || defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  #define USE_SSE_FILTERS
+#endif
+
 #define safebuf static
 
 // Solaris defines _LITTLE_ENDIAN or _BIG_ENDIAN.
@@ -116,6 +116,7 @@ void QuickOpen::Load(uint64 BlockPos)
   ReadBufPos=0;
   LastReadHeader.Reset();
   LastReadHeaderPos=0;
+  PrevReadHeaderEnd=0;
 
   ReadBuffer();
 }
@@ -134,7 +135,7 @@ bool QuickOpen::Read(void *Data,size_t Size,size_t &Result)
     // If something wrong happened, let's set the correct file pointer
     // and stop further quick open processing.
     if (UnsyncSeekPos)
-      Arc->File::Seek(SeekPos,SEEK_SET);
+      Arc->ArcSeek(SeekPos,SEEK_SET);
     return false;
   }
 
@@ -149,10 +150,10 @@ bool QuickOpen::Read(void *Data,size_t Size,size_t &Result)
   {
     if (UnsyncSeekPos)
     {
-      Arc->File::Seek(SeekPos,SEEK_SET);
+      Arc->ArcSeek(SeekPos,SEEK_SET);
       UnsyncSeekPos=false;
     }
-    int ReadSize=Arc->File::Read(Data,Size);
+    int ReadSize=Arc->ArcRead(Data,Size);
     if (ReadSize<0)
     {
       Loaded=false;
@@ -175,7 +176,10 @@ bool QuickOpen::Seek(int64 Offset,int Method)
   // so we read quick open data sequentially. But some operations like
   // archive updating involve several passes. So if we detect that file
   // pointer is moved back, we reload quick open data from beginning.
-  if (Method==SEEK_SET && (uint64)Offset<SeekPos && (uint64)Offset<LastReadHeaderPos)
+  // We do not reload it if there are no cached headers between new and
+  // last read positions, like when returning to file data after reading
+  // the next header.
+  if (Method==SEEK_SET && (uint64)Offset<SeekPos && (uint64)Offset<PrevReadHeaderEnd)
     Load(QOHeaderPos);
 
   if (Method==SEEK_SET)
@@ -186,8 +190,8 @@ bool QuickOpen::Seek(int64 Offset,int Method)
 
   if (Method==SEEK_END)
   {
-    Arc->File::Seek(Offset,SEEK_END);
-    SeekPos=Arc->File::Tell();
+    Arc->ArcSeek(Offset,SEEK_END);
+    SeekPos=Arc->ArcTell();
     UnsyncSeekPos=false;
   }
   return true;
@@ -206,14 +210,14 @@ bool QuickOpen::Tell(int64 *Pos)
 uint QuickOpen::ReadBuffer()
 {
   int64 SavePos=Arc->Tell();
-  Arc->File::Seek(RawDataStart+RawDataPos,SEEK_SET);
+  Arc->ArcSeek(RawDataStart+RawDataPos,SEEK_SET);
   size_t SizeToRead=(size_t)Min(RawDataSize-RawDataPos,MaxBufSize-ReadBufSize);
   if (Arc->SubHead.Encrypted)
     SizeToRead &= ~CRYPT_BLOCK_MASK;
   int ReadSize=0;
   if (SizeToRead!=0)
   {
-    ReadSize=Arc->File::Read(Buf+ReadBufSize,SizeToRead);
+    ReadSize=Arc->ArcRead(Buf+ReadBufSize,SizeToRead);
     if (ReadSize<=0)
       ReadSize=0;
     else
@@ -292,6 +296,7 @@ bool QuickOpen::ReadNext()
   size_t HeaderSize=(size_t)Raw.GetV();
   if (HeaderSize>MAX_HEADER_SIZE_RAR5)
     return false;
+  PrevReadHeaderEnd=LastReadHeaderPos+LastReadHeader.Size();
   LastReadHeader.Alloc(HeaderSize);
   Raw.GetB(&LastReadHeader[0],HeaderSize);
   // Calculate the absolute position as offset from quick open service header.
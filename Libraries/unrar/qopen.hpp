@@ -45,6 +45,7 @@ class QuickOpen
     size_t ReadBufPos;   // Current read position in Buf data.
     Array<byte> LastReadHeader;
     uint64 LastReadHeaderPos;
+    uint64 PrevReadHeaderEnd; // End of cached header preceding LastReadHeader.
     uint64 SeekPos;
     bool UnsyncSeekPos;  // QOpen SeekPos does not match an actual file pointer.
   public:
@@ -39,11 +39,15 @@
 #include "filestr.hpp"
 #include "find.hpp"
 #include "scantree.hpp"
+#include "rawint.hpp"
 #include "getbits.hpp"
 #include "rdwrfn.hpp"
 #ifdef USE_QOPEN
 #include "qopen.hpp"
 #endif
+#ifdef USE_ARCMEM
+#include "arcmem.hpp"
+#endif
 #include "archive.hpp"
 #include "match.hpp"
 #include "cmddata.hpp"
@@ -51,8 +55,10 @@
 #include "consio.hpp"
 #include "system.hpp"
 #include "log.hpp"
-#include "rawint.hpp"
 #include "rawread.hpp"
+#ifdef RARDLL
+#include "arcindex.hpp"
+#endif
 #include "encname.hpp"
 #include "resource.hpp"
 #include "compress.hpp"
@@ -61,6 +67,8 @@
 #include "model.hpp"
 
 #include "threadpool.hpp"
+#include "readahead.hpp"
+#include "writebehind.hpp"
 
 #include "unpack.hpp"
 
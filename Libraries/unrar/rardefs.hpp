@@ -25,6 +25,11 @@
 #define USE_QOPEN
 #endif
 
+// Allow to open archives from memory blocks provided by DLL caller.
+#ifdef RARDLL
+#define USE_ARCMEM
+#endif
+
 // Produce the value, which is equal or larger than 'v' and aligned to 'a'.
 #define ALIGN_VALUE(v,a) (size_t(v) + ( (~size_t(v) + 1) & (a - 1) ) )
 
@@ -92,6 +92,19 @@ inline uint32 RawGetBE4(const byte *m)
 }
 
 
+// Load 8 big endian bytes from memory and return uint64.
+inline uint64 RawGetBE8(const byte *m)
+{
+#if defined(USE_MEM_BYTESWAP) && defined(_MSC_VER)
+  return _byteswap_uint64(*(uint64 *)m);
+#elif defined(USE_MEM_BYTESWAP) && defined(__GNUC__)
+  return __builtin_bswap64(*(uint64 *)m);
+#else
+  return INT32TO64(RawGetBE4(m),RawGetBE4(m+4));
+#endif
+}
+
+
 // Save integer to memory as big endian.
 inline void RawPutBE4(uint32 i,byte *mem)
 {
@@ -6,6 +6,11 @@ ComprDataIO::ComprDataIO()
   Crypt=new CryptData;
   Decrypt=new CryptData;
 #endif
+#ifdef RAR_SMP
+  ReadAhead=NULL;
+  WriteBehind=NULL;
+  WriteBehindAllowed=false;
+#endif
 
   Init();
 }
@@ -15,6 +20,10 @@ void ComprDataIO::Init()
 {
   UnpackFromMemory=false;
   UnpackToMemory=false;
+#ifdef RARDLL
+  UnpackToMemoryList=NULL;
+  UnpackToMemoryListCount=0;
+#endif
   UnpPackedSize=0;
   UnpPackedLeft=0;
   ShowProgress=true;
@@ -28,6 +37,8 @@ void ComprDataIO::Init()
   DestFile=NULL;
   UnpWrAddr=NULL;
   UnpWrSize=0;
+  UnpDataInDest=false;
+  UnpHashSkipped=false;
   Command=NULL;
   Encryption=false;
   Decryption=false;
@@ -48,6 +59,10 @@ ComprDataIO::~ComprDataIO()
   delete Crypt;
   delete Decrypt;
 #endif
+#ifdef RAR_SMP
+  delete ReadAhead;
+  delete WriteBehind;
+#endif
 }
 
 
@@ -98,7 +113,13 @@ int ComprDataIO::UnpRead(byte *Addr,size_t Count)
 
         if (!SrcFile->IsOpened())
           return -1;
-        ReadSize=SrcFile->Read(ReadAddr,SizeToRead);
+#ifdef RAR_SMP
+        ArcReadAhead *RA=GetReadAhead(SrcArc);
+        if (RA!=NULL)
+          ReadSize=RA->Read(SrcArc,ReadAddr,SizeToRead);
+        else
+#endif
+          ReadSize=SrcFile->Read(ReadAddr,SizeToRead);
         FileHeader *hd=SubHead!=NULL ? SubHead:&SrcArc->FileHead;
         if (!NoFileHeader && hd->SplitAfter)
           PackedDataHash.Update(ReadAddr,ReadSize);
@@ -151,6 +172,54 @@ int ComprDataIO::UnpRead(byte *Addr,size_t Count)
 }
 
 
+#ifdef RAR_SMP
+// Return background reader of packed data if it is enabled
+// and archive is read from regular file.
+ArcReadAhead* ComprDataIO::GetReadAhead(Archive *Arc)
+{
+  size_t Size=Arc->GetRAROptions()->ReadAheadSize;
+  if (Size==0 || SubHead!=NULL || !Arc->IsFileInput() || !Arc->IsSeekable())
+    return NULL;
+  if (ReadAhead==NULL)
+    ReadAhead=new ArcReadAhead(Size,Arc->GetRAROptions()->ReadNoCache);
+  return ReadAhead;
+}
+
+
+// Return background writer of unpacked data if it is enabled and
+// permitted for current destination file, which must be a regular file.
+FileWriteBehind* ComprDataIO::GetWriteBehind()
+{
+  if (WriteBehind!=NULL && WriteBehind->IsActive())
+    return WriteBehind;
+  size_t Size=((Archive *)SrcFile)->GetRAROptions()->WriteBehindSize;
+  if (Size==0 || !WriteBehindAllowed || SubHead!=NULL ||
+      DestFile->GetHandleType()!=FILE_HANDLENORMAL)
+    return NULL;
+  if (WriteBehind==NULL)
+    WriteBehind=new FileWriteBehind(Size);
+  WriteBehind->Start(DestFile);
+  return WriteBehind;
+}
+
+
+// Write all data queued for background writing to destination file.
+void ComprDataIO::FinishWrite()
+{
+  if (WriteBehind!=NULL)
+    WriteBehind->Finish();
+}
+
+
+// Wait for background writes, dropping not queued data.
+void ComprDataIO::CancelWrite()
+{
+  if (WriteBehind!=NULL)
+    WriteBehind->Cancel();
+}
+#endif
+
+
 void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
 {
 
@@ -174,16 +243,29 @@ void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
   UnpWrSize=Count;
   if (UnpackToMemory)
   {
-    if (Count <= UnpackToMemorySize)
-    {
-      memcpy(UnpackToMemoryAddr,Addr,Count);
-      UnpackToMemoryAddr+=Count;
-      UnpackToMemorySize-=Count;
-    }
+#ifdef RARDLL
+    if (UnpackToMemoryList!=NULL)
+      UnpWriteToList(Addr,Count);
+    else
+#endif
+      if (Count <= UnpackToMemorySize)
+      {
+        memcpy(UnpackToMemoryAddr,Addr,Count);
+        UnpackToMemoryAddr+=Count;
+        UnpackToMemorySize-=Count;
+      }
   }
   else
-    if (!TestMode)
-      DestFile->Write(Addr,Count);
+    if (!TestMode && !UnpDataInDest)
+    {
+#ifdef RAR_SMP
+      FileWriteBehind *WB=GetWriteBehind();
+      if (WB!=NULL)
+        WB->Write(Addr,Count);
+      else
+#endif
+        DestFile->Write(Addr,Count);
+    }
   CurUnpWrite+=Count;
   if (!SkipUnpCRC)
     UnpHash.Update(Addr,Count);
@@ -196,6 +278,141 @@ void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
 
 
 
+#ifdef USE_COPY_RANGE
+// Copy Size bytes from SrcFD to DestFD at specified positions in kernel.
+// Return the number of copied bytes or -1 if it is not supported for these
+// files. We try sendfile if copy_file_range fails, for example, for files
+// on different file systems in older Linux kernels.
+static ssize_t CopyFileRange(int SrcFD,int64 SrcPos,int DestFD,int64 DestPos,
+                             size_t Size,bool &UseSendfile)
+{
+  if (!UseSendfile)
+  {
+    loff_t SrcOffset=SrcPos,DestOffset=DestPos;
+    ssize_t Result=copy_file_range(SrcFD,&SrcOffset,DestFD,&DestOffset,Size,0);
+    if (Result>=0)
+      return Result;
+    UseSendfile=true;
+  }
+  if (lseek(DestFD,DestPos,SEEK_SET)==-1)
+    return -1;
+  off_t SrcOffset=SrcPos;
+  return sendfile(DestFD,SrcFD,&SrcOffset,Size);
+}
+
+
+// Copy unencrypted stored file data from archive file to destination file
+// without passing it through our buffers. We map the data to memory only
+// if we need to calculate its hash or pass it to callbacks. Return the size
+// of copied data, so caller can process the rest, if any, as usual.
+int64 ComprDataIO::CopyStoredData(int64 DestSize)
+{
+  Archive *SrcArc=(Archive *)SrcFile;
+  if (Decryption || UnpackFromMemory || UnpackToMemory || TestMode ||
+      SubHead!=NULL || NoFileHeader || DestFile==NULL ||
+      DestFile->GetHandleType()!=FILE_HANDLENORMAL || DestFile->IsSparseWrite() ||
+      !SrcArc->IsFileInput() || !SrcArc->IsSeekable())
+    return 0;
+
+  RAROptions *Cmd=SrcArc->GetRAROptions();
+  FileHeader *hd=&SrcArc->FileHead;
+
+  // We always need hash for files split between volumes, because we check
+  // the packed data hash of every part.
+  bool CalcHash=!SkipUnpCRC && (!Cmd->SkipStoredHash || hd->SplitBefore || hd->SplitAfter);
+  bool PassData=CalcHash;
+#ifdef RARDLL
+  if (Cmd->DllOpMode!=RAR_SKIP && (Cmd->Callback!=NULL || Cmd->ProcessDataProc!=NULL))
+    PassData=true;
+#endif
+
+  const size_t CopyChunk=0x400000;
+  size_t PageSize=(size_t)sysconf(_SC_PAGESIZE);
+  bool UseSendfile=false;
+  int64 DestPos=DestFile->Tell();
+  int64 Copied=0;
+  while (Copied<DestSize)
+  {
+    if (UnpPackedLeft==0)
+    {
+      if (!UnpVolume)
+        break;
+      if (!MergeArchive(*SrcArc,this,true,CurrentCommand))
+      {
+        NextVolumeMissing=true;
+        break;
+      }
+      continue;
+    }
+
+    size_t Size=(size_t)Min(Min(UnpPackedLeft,DestSize-Copied),CopyChunk);
+    int64 SrcPos=SrcArc->Tell();
+    int SrcFD=SrcArc->GetFD();
+
+    byte *Data=NULL;
+    void *MapAddr=MAP_FAILED;
+    size_t MapSize=0;
+    if (PassData || hd->SplitAfter)
+    {
+      int64 MapPos=SrcPos & ~(int64)(PageSize-1);
+      MapSize=Size+size_t(SrcPos-MapPos);
+      MapAddr=mmap(NULL,MapSize,PROT_READ,MAP_SHARED,SrcFD,(off_t)MapPos);
+      if (MapAddr==MAP_FAILED)
+        break;
+      Data=(byte *)MapAddr+(SrcPos-MapPos);
+    }
+
+    ssize_t Result=CopyFileRange(SrcFD,SrcPos,DestFile->GetFD(),DestPos,Size,UseSendfile);
+    if (Result<=0)
+    {
+      if (MapAddr!=MAP_FAILED)
+        munmap(MapAddr,MapSize);
+      break;
+    }
+    SrcArc->Seek(SrcPos+Result,SEEK_SET);
+    DestPos+=Result;
+    Copied+=Result;
+
+    // Synchronize the file position, which can be cached by stdio
+    // and is used to drop data from page cache.
+    DestFile->Seek(DestPos,SEEK_SET);
+
+    // Same processing as in UnpRead and UnpWrite, except reading and writing.
+    CurUnpRead+=Result;
+    UnpPackedLeft-=Result;
+    if (hd->SplitAfter)
+      PackedDataHash.Update(Data,Result);
+    ShowUnpRead(SrcArc->NextBlockPos-UnpPackedSize+CurUnpRead,TotalArcSize);
+    if (PassData)
+    {
+      bool SkipCRC=SkipUnpCRC;
+      SkipUnpCRC=!CalcHash;
+      UnpDataInDest=true;
+      UnpWrite(Data,Result);
+      UnpDataInDest=false;
+      SkipUnpCRC=SkipCRC;
+    }
+    else
+    {
+      CurUnpWrite+=Result;
+      ShowUnpWrite();
+      Wait();
+    }
+    if (MapAddr!=MAP_FAILED)
+      munmap(MapAddr,MapSize);
+
+    // Mapped pages cannot be dropped from page cache, so we do it here.
+    SrcArc->DropCache(false);
+    DestFile->DropCache(false);
+  }
+
+  if (Copied>0 && !CalcHash && !SkipUnpCRC)
+    UnpHashSkipped=true;
+  return Copied;
+}
+#endif
+
+
 void ComprDataIO::ShowUnpRead(int64 ArcPos,int64 ArcSize)
 {
   if (ShowProgress && SrcFile!=NULL)
@@ -284,9 +501,53 @@ void ComprDataIO::SetUnpackToMemory(byte *Addr,uint Size)
   UnpackToMemory=true;
   UnpackToMemoryAddr=Addr;
   UnpackToMemorySize=Size;
+#ifdef RARDLL
+  UnpackToMemoryList=NULL;
+  UnpackToMemoryListCount=0;
+#endif
 }
 
 
+#ifdef RARDLL
+// Unpack to the scatter list of memory blocks. Zero Count turns off
+// unpacking to memory.
+void ComprDataIO::SetUnpackToMemory(RARUnpackBuffer *List,size_t Count)
+{
+  UnpackToMemory=Count>0;
+  UnpackToMemoryAddr=NULL;
+  UnpackToMemorySize=0;
+  UnpackToMemoryList=Count>0 ? List:NULL;
+  UnpackToMemoryListCount=Count;
+}
+
+
+// Fill scatter list blocks one after another. Data exceeding the total
+// size of blocks is discarded.
+void ComprDataIO::UnpWriteToList(byte *Addr,size_t Count)
+{
+  while (Count>0)
+  {
+    if (UnpackToMemorySize==0)
+    {
+      if (UnpackToMemoryListCount==0)
+        break;
+      UnpackToMemoryAddr=UnpackToMemoryList->Addr;
+      UnpackToMemorySize=UnpackToMemoryList->Size;
+      UnpackToMemoryList++;
+      UnpackToMemoryListCount--;
+      continue;
+    }
+    size_t CopySize=Min(Count,UnpackToMemorySize);
+    memcpy(UnpackToMemoryAddr,Addr,CopySize);
+    UnpackToMemoryAddr+=CopySize;
+    UnpackToMemorySize-=CopySize;
+    Addr+=CopySize;
+    Count-=CopySize;
+  }
+}
+#endif
+
+
 // Extraction progress is based on the position in archive and we adjust 
 // the total archives size here, so trailing blocks do not prevent progress
 // reaching 100% at the end of extraction. Alternatively we could print "100%"
@@ -5,6 +5,8 @@ class Archive;
 class CmdAdd;
 class Unpack;
 class ArcFileSearch;
+class ArcReadAhead;
+class FileWriteBehind;
 
 #if 0
 // We use external i/o calls for Benchmark command.
@@ -16,7 +18,10 @@ class ComprDataIO
   private:
     void ShowUnpRead(int64 ArcPos,int64 ArcSize);
     void ShowUnpWrite();
-
+#ifdef RAR_SMP
+    ArcReadAhead* GetReadAhead(Archive *Arc);
+    FileWriteBehind* GetWriteBehind();
+#endif
 
     bool UnpackFromMemory;
     size_t UnpackFromMemorySize;
@@ -26,9 +31,21 @@ class ComprDataIO
     size_t UnpackToMemorySize;
     byte *UnpackToMemoryAddr;
 
+#ifdef RARDLL
+    void UnpWriteToList(byte *Addr,size_t Count);
+
+    // Memory blocks following the current UnpackToMemoryAddr block,
+    // if unpacking to scatter list.
+    RARUnpackBuffer *UnpackToMemoryList;
+    size_t UnpackToMemoryListCount;
+#endif
+
     size_t UnpWrSize;
     byte *UnpWrAddr;
 
+    // Data passed to UnpWrite is already copied to DestFile.
+    bool UnpDataInDest;
+
     int64 UnpPackedSize;
     int64 UnpPackedLeft;
 
@@ -55,6 +72,15 @@ class ComprDataIO
 
     wchar CurrentCommand;
 
+#ifdef RAR_SMP
+    // Background reader of packed data, created when enabled in options.
+    ArcReadAhead *ReadAhead;
+
+    // Background writer of unpacked data, created when enabled in options.
+    FileWriteBehind *WriteBehind;
+    bool WriteBehindAllowed;
+#endif
+
   public:
     ComprDataIO();
     ~ComprDataIO();
@@ -75,13 +101,25 @@ class ComprDataIO
     void SetAV15Encryption();
     void SetCmt13Encryption();
     void SetUnpackToMemory(byte *Addr,uint Size);
+#ifdef RARDLL
+    void SetUnpackToMemory(RARUnpackBuffer *List,size_t Count);
+#endif
     void SetCurrentCommand(wchar Cmd) {CurrentCommand=Cmd;}
     void AdjustTotalArcSize(Archive *Arc);
+#ifdef USE_COPY_RANGE
+    int64 CopyStoredData(int64 DestSize);
+#endif
+#ifdef RAR_SMP
+    void SetWriteBehind(bool Allow) {WriteBehindAllowed=Allow;}
+    void FinishWrite();
+    void CancelWrite();
+#endif
 
 
     bool PackVolume;
     bool UnpVolume;
     bool NextVolumeMissing;
+    bool UnpHashSkipped; // Unpacked data hash is not calculated on request.
     int64 CurPackRead,CurPackWrite,CurUnpRead,CurUnpWrite;
 
 
@@ -0,0 +1,189 @@
+#include "rar.hpp"
+
+#ifdef RAR_SMP
+
+THREAD_PROC(ReadAheadThread)
+{
+  ArcReadAhead::Chunk *C=(ArcReadAhead::Chunk *)Data;
+  C->Owner->ReadChunk(C);
+}
+
+
+ArcReadAhead::ArcReadAhead(size_t Size,bool NoCache)
+{
+  // Two chunks of current volume together contain the requested size.
+  ChunkSize=Max(Size/2,0x10000);
+  Pool=new ThreadPool(1);
+  Pending=NULL;
+  LastOrder=0;
+  for (uint I=0;I<ASIZE(Chunks);I++)
+  {
+    Chunk *C=Chunks+I;
+    C->Owner=this;
+    *C->VolName=0;
+    C->Pos=0;
+    C->Size=0;
+    C->ReadSize=-1;
+    C->Valid=false;
+    C->Order=0;
+  }
+
+  // Background thread must not throw. If it fails, main thread reads
+  // the same data directly and reports the error.
+  SrcFile.SetExceptions(false);
+  SrcFile.SetNoCache(NoCache);
+}
+
+
+ArcReadAhead::~ArcReadAhead()
+{
+  WaitPending();
+  delete Pool;
+}
+
+
+ArcReadAhead::Chunk* ArcReadAhead::Find(const wchar *VolName,int64 Pos)
+{
+  for (uint I=0;I<ASIZE(Chunks);I++)
+  {
+    Chunk *C=Chunks+I;
+    if (C->Valid && Pos>=C->Pos && Pos<C->Pos+(int64)C->Size &&
+        wcscmp(C->VolName,VolName)==0)
+      return C;
+  }
+  return NULL;
+}
+
+
+// Start reading a chunk in background thread. We reuse the oldest chunk
+// except Keep, which is used by main thread now.
+ArcReadAhead::Chunk* ArcReadAhead::Request(const wchar *VolName,int64 Pos,Chunk *Keep)
+{
+  // We read one chunk at a time, so unpacking does not compete
+  // with several our reads.
+  WaitPending();
+
+  Chunk *C=NULL;
+  for (uint I=0;I<ASIZE(Chunks);I++)
+    if (Chunks+I!=Keep && (C==NULL || Chunks[I].Order<C->Order))
+      C=Chunks+I;
+
+  if (C->Data.Size()<ChunkSize)
+    C->Data.Alloc(ChunkSize);
+  wcsncpyz(C->VolName,VolName,ASIZE(C->VolName));
+  C->Pos=Pos;
+  C->Size=ChunkSize;
+  C->ReadSize=-1;
+  C->Valid=true;
+  C->Order=++LastOrder;
+
+  Pending=C;
+  Pool->AddTask(ReadAheadThread,C);
+  Pool->StartTasks();
+  return C;
+}
+
+
+// Request data following the chunk used now, unless it is already
+// requested. If chunk reached the end of volume, we request the beginning
+// of next volume. Archive headers preceding file data in next volume
+// are small, so it also contains the first data we need there.
+void ArcReadAhead::RequestNext(Archive *Arc,Chunk *Cur)
+{
+  if (Cur->ReadSize==(int)Cur->Size)
+  {
+    int64 NextPos=Cur->Pos+Cur->Size;
+    if (Find(Cur->VolName,NextPos)==NULL)
+      Request(Cur->VolName,NextPos,Cur);
+  }
+  else
+    if (Arc->Volume && Cur->ReadSize>=0)
+    {
+      wchar NextName[NM];
+      wcsncpyz(NextName,Cur->VolName,ASIZE(NextName));
+      NextVolumeName(NextName,ASIZE(NextName),!Arc->NewNumbering);
+      if (Find(NextName,0)==NULL)
+        Request(NextName,0,Cur);
+    }
+}
+
+
+void ArcReadAhead::WaitPending()
+{
+  if (Pending!=NULL)
+  {
+    Pool->WaitDone();
+    Pending=NULL;
+  }
+}
+
+
+// Called in background thread.
+void ArcReadAhead::ReadChunk(Chunk *C)
+{
+  if (!SrcFile.IsOpened() || wcscmp(SrcFile.FileName,C->VolName)!=0)
+  {
+    SrcFile.Close();
+    if (!SrcFile.Open(C->VolName))
+      return;
+  }
+  if (!SrcFile.RawSeek(C->Pos,SEEK_SET))
+    return;
+  size_t TotalRead=0;
+  while (TotalRead<C->Size)
+  {
+    int ReadSize=SrcFile.Read(&C->Data[TotalRead],C->Size-TotalRead);
+    if (ReadSize<0 && TotalRead==0)
+      return;
+    if (ReadSize<=0)
+      break;
+    TotalRead+=ReadSize;
+  }
+  C->ReadSize=(int)TotalRead;
+}
+
+
+// Read archive data at current position of Arc and advance it,
+// same as Arc->Read.
+int ArcReadAhead::Read(Archive *Arc,byte *Addr,size_t Size)
+{
+  int64 Pos=Arc->Tell();
+  size_t TotalRead=0;
+  while (TotalRead<Size)
+  {
+    Chunk *C=Find(Arc->FileName,Pos);
+    if (C==NULL) // Unpacking started at new position.
+      C=Request(Arc->FileName,Pos,NULL);
+    if (C==Pending)
+      WaitPending();
+    size_t Offset=size_t(Pos-C->Pos);
+    if (C->ReadSize<0 || (size_t)C->ReadSize<=Offset)
+    {
+      if (C->ReadSize<0)
+      {
+        C->Valid=false;
+        C->Order=0;
+      }
+      break;
+    }
+    size_t CopySize=Min(Size-TotalRead,(size_t)C->ReadSize-Offset);
+    memcpy(Addr+TotalRead,&C->Data[Offset],CopySize);
+    TotalRead+=CopySize;
+    Pos+=CopySize;
+    RequestNext(Arc,C);
+  }
+  Arc->Seek(Pos,SEEK_SET);
+  if (TotalRead<Size)
+  {
+    // Read error or end of data when reading the chunk. We read the rest
+    // directly to report errors in main thread and to get data appended
+    // to archive after our read.
+    int ReadSize=Arc->Read(Addr+TotalRead,Size-TotalRead);
+    if (ReadSize<0)
+      return TotalRead==0 ? -1:(int)TotalRead;
+    TotalRead+=ReadSize;
+  }
+  return (int)TotalRead;
+}
+
+#endif
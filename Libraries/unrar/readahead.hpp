@@ -0,0 +1,51 @@
+#ifndef _RAR_READAHEAD_
+#define _RAR_READAHEAD_
+
+#ifdef RAR_SMP
+
+// Reads archive data following the current unpack read position in
+// background thread, so unpacking does not wait for slow storage. Data is
+// read with separate file handle to chunks, which are identified by volume
+// name and position. So main thread can switch volumes as usual and we only
+// need to copy data from a ready chunk to unpack buffer. When reaching
+// the end of volume, we read the beginning of next volume.
+class ArcReadAhead
+{
+  public:
+    struct Chunk
+    {
+      ArcReadAhead *Owner;
+      wchar VolName[NM];
+      int64 Pos;     // Volume position of chunk data.
+      Array<byte> Data;
+      size_t Size;   // Requested size.
+      int ReadSize;  // Actually read size, -1 if read failed.
+      bool Valid;    // Chunk is requested and contains or will contain data.
+      uint Order;    // Request order, to reuse the oldest chunk first.
+    };
+  private:
+    Chunk* Find(const wchar *VolName,int64 Pos);
+    Chunk* Request(const wchar *VolName,int64 Pos,Chunk *Keep);
+    void RequestNext(Archive *Arc,Chunk *Cur);
+    void WaitPending();
+
+    ThreadPool *Pool;
+    Chunk *Pending; // Chunk read by background thread now.
+    size_t ChunkSize;
+    uint LastOrder;
+
+    // Two chunks for current volume to read one while other is used
+    // and one for beginning of next volume.
+    Chunk Chunks[3];
+
+    File SrcFile; // Used only by background thread.
+  public:
+    ArcReadAhead(size_t Size,bool NoCache);
+    ~ArcReadAhead();
+    int Read(Archive *Arc,byte *Addr,size_t Size);
+    void ReadChunk(Chunk *C);
+};
+
+#endif
+
+#endif
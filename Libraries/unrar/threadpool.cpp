@@ -46,6 +46,7 @@ ThreadPool::ThreadPool(uint MaxThreads)
   QueueTop = 0;
   QueueBottom = 0;
   ActiveThreads = 0;
+  QueuedCount = 0;
 }
 
 
@@ -162,8 +163,9 @@ bool ThreadPool::GetQueuedTask(QueueEntry *Task)
 
 
 // Add task to queue. We assume that it is always called from main thread,
-// it allows to avoid any locks here. We process collected tasks only
-// when WaitDone is called.
+// it allows to avoid any locks here except the active tasks counter,
+// which can be decremented by already started tasks. We process collected
+// tasks only when StartTasks or WaitDone is called.
 void ThreadPool::AddTask(PTHREAD_PROC Proc,void *Data)
 {
   if (ThreadsCreatedCount == 0)
@@ -176,33 +178,61 @@ void ThreadPool::AddTask(PTHREAD_PROC Proc,void *Data)
   TaskQueue[QueueTop].Proc = Proc;
   TaskQueue[QueueTop].Param = Data;
   QueueTop = (QueueTop + 1) % ASIZE(TaskQueue);
+
+  CriticalSectionStart(&CritSection);
   ActiveThreads++;
+  CriticalSectionEnd(&CritSection);
+  QueuedCount++;
 }
 
 
-// Start queued tasks and wait until all threads are inactive.
-// We assume that it is always called from main thread, when pool threads
-// are sleeping yet.
-void ThreadPool::WaitDone()
+// Start queued tasks and return without waiting for their completion,
+// so the main thread can do something else in parallel. Call WaitDone
+// to wait until all tasks are done.
+void ThreadPool::StartTasks()
 {
-  if (ActiveThreads==0)
+  if (QueuedCount==0)
     return;
+
+  // Threads reset the active state inside of critical section after
+  // completing the last task, so we set it in the same section to not
+  // overwrite the reset made by tasks started earlier.
+  CriticalSectionStart(&CritSection);
 #ifdef _WIN_ALL
   ResetEvent(NoneActive);
-  ReleaseSemaphore(QueuedTasksCnt,ActiveThreads,NULL);
-  CWaitForSingleObject(NoneActive);
 #elif defined(_UNIX)
+  pthread_mutex_lock(&AnyActiveMutex);
   AnyActive=true;
+  pthread_mutex_unlock(&AnyActiveMutex);
+#endif
+  CriticalSectionEnd(&CritSection);
 
+#ifdef _WIN_ALL
+  ReleaseSemaphore(QueuedTasksCnt,QueuedCount,NULL);
+#elif defined(_UNIX)
   // Threads reset AnyActive before accessing QueuedTasksCnt and even
   // preceding WaitDone() call does not guarantee that some slow thread
   // is not accessing QueuedTasksCnt now. So lock is necessary.
   pthread_mutex_lock(&QueuedTasksCntMutex);
-  QueuedTasksCnt+=ActiveThreads;
+  QueuedTasksCnt+=QueuedCount;
   pthread_mutex_unlock(&QueuedTasksCntMutex);
 
   pthread_cond_broadcast(&QueuedTasksCntCond);
+#endif
+  QueuedCount=0;
+}
+
 
+// Start queued tasks if not started yet and wait until all threads
+// are inactive. We assume that it is always called from main thread.
+void ThreadPool::WaitDone()
+{
+  if (ActiveThreads==0)
+    return;
+  StartTasks();
+#ifdef _WIN_ALL
+  CWaitForSingleObject(NoneActive);
+#elif defined(_UNIX)
   pthread_mutex_lock(&AnyActiveMutex);
   while (AnyActive)
     cpthread_cond_wait(&AnyActiveCond,&AnyActiveMutex);
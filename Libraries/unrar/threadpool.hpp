@@ -60,6 +60,9 @@ class ThreadPool
 
     uint ActiveThreads;
 
+    // Number of tasks added to queue, but not started yet.
+    uint QueuedCount;
+
   	QueueEntry TaskQueue[MaxPoolThreads];
   	uint QueueTop;
   	uint QueueBottom;
@@ -93,6 +96,7 @@ class ThreadPool
     ThreadPool(uint MaxThreads);
     ~ThreadPool();
     void AddTask(PTHREAD_PROC Proc,void *Data);
+    void StartTasks();
     void WaitDone();
 
 #ifdef _WIN_ALL
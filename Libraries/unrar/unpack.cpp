@@ -12,6 +12,9 @@
 #include "unpack20.cpp"
 #endif
 #include "unpack30.cpp"
+#ifdef USE_SSE_FILTERS
+#include "unpack50sse.cpp"
+#endif
 #include "unpack50.cpp"
 #include "unpack50frag.cpp"
 
@@ -27,11 +30,15 @@ Unpack::Unpack(ComprDataIO *DataIO)
 #ifdef RAR_SMP
   MaxUserThreads=1;
   UnpThreadPool=NULL;
+  FilterThreadPool=NULL;
   ReadBufMT=NULL;
+  ReadBufSizeMT=0;
   UnpThreadData=NULL;
 #endif
   MaxWinSize=0;
   MaxWinMask=0;
+  WinDirtySize=0;
+  WinDirtyPtr=0;
 
   // Perform initialization, which should be done only once for all files.
   // It prevents crash if first DoUnpack call is later made with wrong
@@ -49,12 +56,30 @@ Unpack::~Unpack()
 {
   InitFilters30(false);
 
-  if (Window!=NULL)
-    free(Window);
+  // Return buffers to process wide pool, so other Unpack objects
+  // can reuse them instead of allocating new ones.
+  ReleaseWindow();
 #ifdef RAR_SMP
   delete UnpThreadPool;
-  delete[] ReadBufMT;
-  delete[] UnpThreadData;
+  delete FilterThreadPool;
+  if (ReadBufMT!=NULL)
+  {
+    size_t AllocSize=ReadBufSizeMT+UNP_READ_OVERFLOW_MT;
+    if (!UnpBufPool.Put(ReadBufMT,AllocSize,AllocSize))
+      free(ReadBufMT);
+  }
+  if (UnpThreadData!=NULL)
+  {
+    for (uint I=0;I<2*MaxUserThreads*UNP_MAX_BLOCKS_PER_THREAD;I++)
+    {
+      UnpackThreadData *CurData=UnpThreadData+I;
+      size_t DecodedSize=CurData->DecodedAllocated*sizeof(UnpackDecodedItem);
+      if (CurData->Decoded!=NULL)
+        if (UnpBufPool.Put(CurData->Decoded,DecodedSize,DecodedSize))
+          CurData->Decoded=NULL; // Prevent freeing in destructor.
+    }
+    delete[] UnpThreadData;
+  }
 #endif
 }
 
@@ -62,9 +87,9 @@ Unpack::~Unpack()
 #ifdef RAR_SMP
 void Unpack::SetThreads(uint Threads)
 {
-  // More than 8 threads are unlikely to provide noticeable gain
-  // for unpacking, but would use the additional memory.
-  MaxUserThreads=Min(Threads,8);
+  // Read buffer and decoding data grow with number of threads,
+  // see InitMT() and Unpack5MT() for details.
+  MaxUserThreads=Min(Threads,MaxPoolThreads);
   UnpThreadPool=new ThreadPool(MaxUserThreads);
 }
 #endif
@@ -102,7 +127,22 @@ void Unpack::Init(size_t WinSize,bool Solid)
   if (Grow && Fragmented)
     throw std::bad_alloc();
 
-  byte *NewWindow=Fragmented ? NULL : (byte *)malloc(WinSize);
+  // Clean the window to generate the same output when unpacking corrupt
+  // RAR files, which may access unused areas of sliding dictionary.
+  // We use calloc instead of malloc and memset, because large blocks are
+  // provided by OS as already zeroed pages, which are not touched until
+  // we really write to them. So extracting a small file with huge
+  // dictionary does not need to fill gigabytes of memory.
+  byte *NewWindow=NULL;
+  if (!Fragmented)
+  {
+    // Reuse the window released by another Unpack object if available.
+    // Pool cleans the area used by previous owner, so data of previously
+    // extracted archive cannot leak to output of current one.
+    NewWindow=(byte *)UnpBufPool.Get(WinSize,true);
+    if (NewWindow==NULL)
+      NewWindow=(byte *)calloc(WinSize,1);
+  }
 
   if (NewWindow==NULL)
     if (Grow || WinSize<0x1000000)
@@ -124,10 +164,6 @@ void Unpack::Init(size_t WinSize,bool Solid)
 
   if (!Fragmented)
   {
-    // Clean the window to generate the same output when unpacking corrupt
-    // RAR files, which may access unused areas of sliding dictionary.
-    memset(NewWindow,0,WinSize);
-
     // If Window is not NULL, it means that window size has grown.
     // In solid streams we need to copy data to a new window in such case.
     // RAR archiving code does not allow it in solid streams now,
@@ -136,9 +172,12 @@ void Unpack::Init(size_t WinSize,bool Solid)
       for (size_t I=1;I<=MaxWinSize;I++)
         NewWindow[(UnpPtr-I)&(WinSize-1)]=Window[(UnpPtr-I)&(MaxWinSize-1)];
 
-    if (Window!=NULL)
-      free(Window);
+    ReleaseWindow();
     Window=NewWindow;
+
+    // Grow case fills the entire new window.
+    WinDirtySize=Grow ? WinSize:0;
+    WinDirtyPtr=UnpPtr;
   }
 
   MaxWinSize=WinSize;
@@ -146,6 +185,32 @@ void Unpack::Init(size_t WinSize,bool Solid)
 }
 
 
+// Called before writing unpacked data and when releasing the window.
+// UnpPtr always advances less than window size between such calls,
+// so if it is below its previous value, the window has wrapped around.
+void Unpack::UpdateWinDirtySize()
+{
+  if (UnpPtr<WinDirtyPtr)
+    WinDirtySize=MaxWinSize;
+  else
+    WinDirtySize=Max(WinDirtySize,Min(UnpPtr,MaxWinSize));
+  WinDirtyPtr=UnpPtr;
+}
+
+
+// Return the window to process wide pool or free it if pool is full.
+void Unpack::ReleaseWindow()
+{
+  if (Window!=NULL)
+  {
+    UpdateWinDirtySize();
+    if (!UnpBufPool.Put(Window,MaxWinSize,WinDirtySize))
+      free(Window);
+    Window=NULL;
+  }
+}
+
+
 void Unpack::DoUnpack(uint Method,bool Solid)
 {
   // Methods <50 will crash in Fragmented mode when accessing NULL Window.
@@ -194,12 +259,14 @@ void Unpack::UnpInitData(bool Solid)
 {
   if (!Solid)
   {
+    UpdateWinDirtySize(); // Account the previous file before resetting UnpPtr.
     memset(OldDist,0,sizeof(OldDist));
     OldDistPtr=0;
     LastDist=LastLength=0;
 //    memset(Window,0,MaxWinSize);
     memset(&BlockTables,0,sizeof(BlockTables));
     UnpPtr=WrPtr=0;
+    WinDirtyPtr=0;
     WriteBorder=Min(MaxWinSize,UNPACK_MAX_WRITE)&MaxWinMask;
   }
   // Filters never share several solid files, so we can safely reset them
@@ -363,3 +430,175 @@ void Unpack::MakeDecodeTables(byte *LengthTable,DecodeTable *Dec,uint Size)
     }
   }
 }
+
+
+void Unpack::MakeDecodeTables(byte *LengthTable,LiteralDecodeTable *Dec,uint Size)
+{
+  MakeDecodeTables(LengthTable,(DecodeTable *)Dec,Size);
+
+  // Literal pairs are used only by RAR5 decoder. Older algorithms share
+  // the same table structure, but do not need to spend time to build it.
+  if (Size!=NC)
+    return;
+
+  // Left aligned upper limit code for quick mode. Codes below it are
+  // not longer than QuickBits and can be translated with QuickLen.
+  uint QuickLimit=Dec->DecodeLen[Dec->QuickBits];
+
+  for (uint Code=0;Code<(1U<<MAX_PAIR_DECODE_BITS);Code++)
+  {
+    Dec->PairData[Code]=0;
+
+    // Left align the current code, so it will be in usual bit field format.
+    uint BitField=Code<<(16-MAX_PAIR_DECODE_BITS);
+    if (BitField>=QuickLimit)
+      continue;
+    uint Length1=Dec->QuickLen[BitField>>(16-Dec->QuickBits)];
+    uint Number1=Dec->QuickNum[BitField>>(16-Dec->QuickBits)];
+    if (Number1>=256 || Length1>=MAX_PAIR_DECODE_BITS)
+      continue;
+
+    // Bits following the first code. Bits beyond MAX_PAIR_DECODE_BITS are
+    // zero here, but it does not change the result for codes fitting into
+    // MAX_PAIR_DECODE_BITS, which are the only codes we accept below.
+    BitField=(BitField<<Length1) & 0xffff;
+    if (BitField>=QuickLimit)
+      continue;
+    uint Length2=Dec->QuickLen[BitField>>(16-Dec->QuickBits)];
+    uint Number2=Dec->QuickNum[BitField>>(16-Dec->QuickBits)];
+    if (Number2>=256 || Length1+Length2>MAX_PAIR_DECODE_BITS)
+      continue;
+
+    Dec->PairData[Code]=Number1+(Number2<<8)+((Length1+Length2)<<16);
+  }
+}
+
+
+UnpackBufferPool::UnpackBufferPool()
+{
+  ItemsCount=0;
+  PoolSize=0;
+  MaxPoolSize=0;
+#ifdef _WIN_ALL
+  InitializeCriticalSection(&PoolLock);
+#elif defined(_UNIX)
+  pthread_mutex_init(&PoolLock,NULL);
+#endif
+}
+
+
+UnpackBufferPool::~UnpackBufferPool()
+{
+  Trim(0);
+#ifdef _WIN_ALL
+  DeleteCriticalSection(&PoolLock);
+#elif defined(_UNIX)
+  pthread_mutex_destroy(&PoolLock);
+#endif
+}
+
+
+void UnpackBufferPool::Lock()
+{
+#ifdef _WIN_ALL
+  EnterCriticalSection(&PoolLock);
+#elif defined(_UNIX)
+  pthread_mutex_lock(&PoolLock);
+#endif
+}
+
+
+void UnpackBufferPool::Unlock()
+{
+#ifdef _WIN_ALL
+  LeaveCriticalSection(&PoolLock);
+#elif defined(_UNIX)
+  pthread_mutex_unlock(&PoolLock);
+#endif
+}
+
+
+// Free the oldest cached buffers until their total size is not above MaxSize.
+// Must be called with the pool locked, except the destructor.
+void UnpackBufferPool::Trim(size_t MaxSize)
+{
+  uint Removed=0;
+  while (Removed<ItemsCount && PoolSize>MaxSize)
+  {
+    free(Items[Removed].Buf);
+    PoolSize-=Items[Removed].Size;
+    Removed++;
+  }
+  if (Removed>0)
+  {
+    ItemsCount-=Removed;
+    memmove(Items,Items+Removed,ItemsCount*sizeof(Items[0]));
+  }
+}
+
+
+// Return a cached buffer of exactly Size bytes or NULL if we have none.
+// If Clean is true, buffer is zero filled like allocated with calloc.
+// Otherwise its contents is undefined.
+void* UnpackBufferPool::Get(size_t Size,bool Clean)
+{
+  PoolItem Item;
+  Item.Buf=NULL;
+  Lock();
+  // Search from the end to reuse the most recently released buffer,
+  // which is more likely to be still present in CPU caches.
+  for (uint I=ItemsCount;I>0;I--)
+    if (Items[I-1].Size==Size)
+    {
+      Item=Items[I-1];
+      PoolSize-=Size;
+      ItemsCount--;
+      memmove(Items+I-1,Items+I,(ItemsCount-I+1)*sizeof(Items[0]));
+      break;
+    }
+  Unlock();
+
+  // Clean only the area touched by previous owner. It is much faster than
+  // getting new zero pages from OS for large and mostly unused windows.
+  if (Item.Buf!=NULL && Clean)
+    memset(Item.Buf,0,Item.DirtySize);
+  return Item.Buf;
+}
+
+
+// Put the malloc allocated buffer to pool. Only first DirtySize bytes
+// of buffer can contain non-zero data. Returns false if buffer does not fit
+// the pool limit, so caller is responsible to free it.
+bool UnpackBufferPool::Put(void *Buf,size_t Size,size_t DirtySize)
+{
+  bool Success=false;
+  Lock();
+  if (Size<=MaxPoolSize)
+  {
+    Trim(MaxPoolSize-Size);
+    if (ItemsCount==ASIZE(Items)) // Release the oldest buffer.
+    {
+      free(Items[0].Buf);
+      PoolSize-=Items[0].Size;
+      ItemsCount--;
+      memmove(Items,Items+1,ItemsCount*sizeof(Items[0]));
+    }
+    Items[ItemsCount].Buf=Buf;
+    Items[ItemsCount].Size=Size;
+    Items[ItemsCount].DirtySize=Min(DirtySize,Size);
+    ItemsCount++;
+    PoolSize+=Size;
+    Success=true;
+  }
+  Unlock();
+  return Success;
+}
+
+
+void UnpackBufferPool::SetLimit(size_t Limit)
+{
+  Lock();
+  MaxPoolSize=Limit;
+  Trim(MaxPoolSize);
+  Unlock();
+}
@@ -4,6 +4,9 @@
 // Maximum allowed number of compressed bits processed in quick mode.
 #define MAX_QUICK_DECODE_BITS      10
 
+// Maximum number of compressed bits processed in literal pair decode mode.
+#define MAX_PAIR_DECODE_BITS       12
+
 // Maximum number of filters per entire data block. Must be at least
 // twice more than MAX_PACK_FILTERS to store filters from two data blocks.
 #define MAX_UNPACK_FILTERS       8192
@@ -81,9 +84,21 @@ struct UnpackBlockHeader
 };
 
 
+// Main RAR5 table, which can also resolve two short literals per lookup.
+// Text data is dominated by short literal codes, so it halves the number
+// of table lookups in such case.
+struct LiteralDecodeTable:DecodeTable
+{
+  // Translates MAX_PAIR_DECODE_BITS compressed bits to two literals
+  // in lower 16 bits and their total bit length in upper 16 bits.
+  // Zero if these bits do not start from two literal codes.
+  uint PairData[1<<MAX_PAIR_DECODE_BITS];
+};
+
+
 struct UnpackBlockTables
 {
-  DecodeTable LD;  // Decode literals.
+  LiteralDecodeTable LD;  // Decode literals.
   DecodeTable DD;  // Decode distances.
   DecodeTable LDD; // Decode lower bits of distances.
   DecodeTable RD;  // Decode repeating distances.
@@ -153,6 +168,22 @@ struct UnpackFilter
 };
 
 
+#ifdef RAR_SMP
+// Filter applied to a copy of window data in pool thread, so filters
+// for different data blocks can be processed in parallel.
+struct UnpackFilterMT
+{
+  UnpackFilter Filter;
+  size_t FilterIndex; // Position in Filters array.
+  uint FileOffset;    // WrittenFileSize value when applying this filter.
+  size_t SrcPos,DstPos; // Data and DELTA output positions in FilterMemMT.
+  byte *SrcData,*DstData;
+  byte *OutMem;       // Filtered data set by ApplyFilterMT.
+  Unpack *UnpackPtr;
+};
+#endif
+
+
 struct UnpackFilter30
 {
   unsigned int BlockStart;
@@ -199,6 +230,45 @@ class FragmentedWindow
 };
 
 
+// Process wide cache of unpack windows and multithreading buffers released
+// by destroyed Unpack objects. It allows applications extracting many small
+// archives in a row to reuse already allocated memory instead of
+// allocating, clearing and freeing it for every archive. Buffers are cached
+// only until their total size reaches the limit set by SetLimit(),
+// which is 0 by default, so nothing is cached unless enabled.
+class UnpackBufferPool
+{
+  private:
+    struct PoolItem
+    {
+      void *Buf;
+      size_t Size;
+      size_t DirtySize; // Size of buffer area, which can be non-zero.
+    };
+
+    void Trim(size_t MaxSize);
+
+    PoolItem Items[32];
+    uint ItemsCount;
+    size_t PoolSize; // Total size of all cached buffers.
+    size_t MaxPoolSize;
+
+#ifdef _WIN_ALL
+    CRITICAL_SECTION PoolLock;
+#elif defined(_UNIX)
+    pthread_mutex_t PoolLock;
+#endif
+    void Lock();
+    void Unlock();
+  public:
+    UnpackBufferPool();
+    ~UnpackBufferPool();
+    void* Get(size_t Size,bool Clean);
+    bool Put(void *Buf,size_t Size,size_t DirtySize);
+    void SetLimit(size_t Limit);
+};
+
+
 class Unpack:PackDef
 {
   private:
@@ -207,15 +277,21 @@ class Unpack:PackDef
     void Unpack5MT(bool Solid);
     bool UnpReadBuf();
     void UnpWriteBuf();
+    void CopyWindowData(byte *Dest,size_t WinPos,size_t Size);
     byte* ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt);
+    byte* ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt,uint FileOffset,byte *DstData);
     void UnpWriteArea(size_t StartPtr,size_t EndPtr);
     void UnpWriteData(byte *Data,size_t Size);
     _forceinline uint SlotToLength(BitInput &Inp,uint Slot);
+    void UpdateWinDirtySize();
+    void ReleaseWindow();
     void UnpInitData50(bool Solid);
     bool ReadBlockHeader(BitInput &Inp,UnpackBlockHeader &Header);
     bool ReadTables(BitInput &Inp,UnpackBlockHeader &Header,UnpackBlockTables &Tables);
     void MakeDecodeTables(byte *LengthTable,DecodeTable *Dec,uint Size);
+    void MakeDecodeTables(byte *LengthTable,LiteralDecodeTable *Dec,uint Size);
     _forceinline uint DecodeNumber(BitInput &Inp,DecodeTable *Dec);
+    _forceinline uint DecodeLiteralPair(BitInput &Inp,LiteralDecodeTable *Dec);
     void CopyString();
     inline void InsertOldDist(unsigned int Distance);
     void UnpInitData(bool Solid);
@@ -231,13 +307,22 @@ class Unpack:PackDef
 
 #ifdef RAR_SMP
     void InitMT();
+    void InitDecodedMT(UnpackThreadData &D);
     bool UnpackLargeBlock(UnpackThreadData &D);
     bool ProcessDecoded(UnpackThreadData &D);
+    void ApplyFiltersMT();
 
     ThreadPool *UnpThreadPool;
+
+    // Filters are applied when writing, while UnpThreadPool can decode
+    // the next pass, so we use a separate pool to wait only for filters.
+    ThreadPool *FilterThreadPool;
+    Array<UnpackFilterMT> FiltersMT;
+    Array<byte> FilterMemMT;
     UnpackThreadData *UnpThreadData;
     uint MaxUserThreads;
     byte *ReadBufMT;
+    size_t ReadBufSizeMT; // Not including UNP_READ_OVERFLOW_MT.
 #endif
 
     Array<byte> FilterSrcMemory;
@@ -254,6 +339,11 @@ class Unpack:PackDef
     uint LastDist;
 
     size_t UnpPtr,WrPtr;
+
+    // Size of window area, which could be modified since window allocation,
+    // so we do not need to clean the entire window when reusing it.
+    size_t WinDirtySize;
+    size_t WinDirtyPtr; // UnpPtr value at last WinDirtySize update.
     
     // Top border of read packed data.
     int ReadTop; 
@@ -384,6 +474,7 @@ class Unpack:PackDef
 #ifdef RAR_SMP
     void SetThreads(uint Threads);
     void UnpackDecode(UnpackThreadData &D);
+    void ApplyFilterMT(UnpackFilterMT &F);
 #endif
 
     size_t MaxWinSize;
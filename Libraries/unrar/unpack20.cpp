@@ -149,6 +149,7 @@ void Unpack::Unpack20(bool Solid)
 
 void Unpack::UnpWriteBuf20()
 {
+  UpdateWinDirtySize();
   if (UnpPtr!=WrPtr)
     UnpSomeRead=true;
   if (UnpPtr<WrPtr)
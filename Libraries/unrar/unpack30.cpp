@@ -518,6 +518,8 @@ bool Unpack::UnpReadBuf30()
 
 void Unpack::UnpWriteBuf30()
 {
+  UpdateWinDirtySize();
+
   uint WrittenBorder=(uint)WrPtr;
   uint WriteSize=(uint)((UnpPtr-WrittenBorder)&MaxWinMask);
   for (size_t I=0;I<PrgStack.Size();I++)
@@ -54,6 +54,28 @@ void Unpack::Unpack5(bool Solid)
       }
     }
 
+    // Try to decode two literals at once if we are not close to block end.
+    if (Inp.InAddr<ReadBorder-2)
+    {
+      uint Pair=DecodeLiteralPair(Inp,&BlockTables.LD);
+      if (Pair!=0)
+      {
+        // UnpPtr is masked at the beginning of loop, so only the second
+        // literal can cross the window border.
+        if (Fragmented)
+        {
+          FragWindow[UnpPtr++]=(byte)Pair;
+          FragWindow[UnpPtr++ & MaxWinMask]=(byte)(Pair>>8);
+        }
+        else
+        {
+          Window[UnpPtr++]=(byte)Pair;
+          Window[UnpPtr++ & MaxWinMask]=(byte)(Pair>>8);
+        }
+        continue;
+      }
+    }
+
     uint MainSlot=DecodeNumber(Inp,&BlockTables.LD);
     if (MainSlot<256)
     {
@@ -254,10 +276,20 @@ bool Unpack::UnpReadBuf()
 
 void Unpack::UnpWriteBuf()
 {
+  UpdateWinDirtySize();
+
   size_t WrittenBorder=WrPtr;
   size_t FullWriteSize=(UnpPtr-WrittenBorder)&MaxWinMask;
   size_t WriteSizeLeft=FullWriteSize;
   bool NotAllFiltersProcessed=false;
+#ifdef RAR_SMP
+  // Apply filters for the entire write range in parallel in advance.
+  // Prepared results are consumed in the same order in the loop below.
+  size_t FilterPosMT=0;
+  FiltersMT.SoftReset();
+  if (MaxUserThreads>1)
+    ApplyFiltersMT();
+#endif
   for (size_t I=0;I<Filters.Size();I++)
   {
     // Here we apply filters to data which we need to write.
@@ -303,31 +335,23 @@ void Unpack::UnpWriteBuf()
         {
           uint BlockEnd=(BlockStart+BlockLength)&MaxWinMask;
 
-          FilterSrcMemory.Alloc(BlockLength);
-          byte *Mem=&FilterSrcMemory[0];
-          if (BlockStart<BlockEnd || BlockEnd==0)
+          byte *OutMem;
+#ifdef RAR_SMP
+          UnpackFilterMT *FltMT=FilterPosMT<FiltersMT.Size() ? &FiltersMT[FilterPosMT] : NULL;
+          if (FltMT!=NULL && FltMT->FilterIndex==I && FltMT->FileOffset==(uint)WrittenFileSize)
           {
-            if (Fragmented)
-              FragWindow.CopyData(Mem,BlockStart,BlockLength);
-            else
-              memcpy(Mem,Window+BlockStart,BlockLength);
+            OutMem=FltMT->OutMem;
+            FilterPosMT++;
           }
           else
+#endif
           {
-            size_t FirstPartLength=size_t(MaxWinSize-BlockStart);
-            if (Fragmented)
-            {
-              FragWindow.CopyData(Mem,BlockStart,FirstPartLength);
-              FragWindow.CopyData(Mem+FirstPartLength,0,BlockEnd);
-            }
-            else
-            {
-              memcpy(Mem,Window+BlockStart,FirstPartLength);
-              memcpy(Mem+FirstPartLength,Window,BlockEnd);
-            }
-          }
+            FilterSrcMemory.Alloc(BlockLength);
+            byte *Mem=&FilterSrcMemory[0];
+            CopyWindowData(Mem,BlockStart,BlockLength);
 
-          byte *OutMem=ApplyFilter(Mem,BlockLength,flt);
+            OutMem=ApplyFilter(Mem,BlockLength,flt);
+          }
 
           Filters[I].Type=FILTER_NONE;
 
@@ -395,7 +419,40 @@ void Unpack::UnpWriteBuf()
 }
 
 
+// Copy window data to contiguous memory block, taking into account
+// the window wrap around.
+void Unpack::CopyWindowData(byte *Dest,size_t WinPos,size_t Size)
+{
+  size_t FirstPartLength=Min(Size,MaxWinSize-WinPos);
+  if (Fragmented)
+  {
+    FragWindow.CopyData(Dest,WinPos,FirstPartLength);
+    FragWindow.CopyData(Dest+FirstPartLength,0,Size-FirstPartLength);
+  }
+  else
+  {
+    memcpy(Dest,Window+WinPos,FirstPartLength);
+    memcpy(Dest+FirstPartLength,Window,Size-FirstPartLength);
+  }
+}
+
+
 byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
+{
+  byte *DstData=NULL;
+  if (Flt->Type==FILTER_DELTA)
+  {
+    FilterDstMemory.Alloc(DataSize);
+    DstData=&FilterDstMemory[0];
+  }
+  return ApplyFilter(Data,DataSize,Flt,(uint)WrittenFileSize,DstData);
+}
+
+
+// Does not access any Unpack members, so it is safe to call from
+// several threads for different data blocks. DstData is used only
+// by DELTA filter and must have at least DataSize bytes.
+byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt,uint FileOffset,byte *DstData)
 {
   byte *SrcData=Data;
   switch(Flt->Type)
@@ -403,14 +460,20 @@ byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
     case FILTER_E8:
     case FILTER_E8E9:
       {
-        uint FileOffset=(uint)WrittenFileSize;
-
         const uint FileSize=0x1000000;
         byte CmpByte2=Flt->Type==FILTER_E8E9 ? 0xe9:0xe8;
         // DataSize is unsigned, so we use "CurPos+4" and not "DataSize-4"
         // to avoid overflow for DataSize<4.
         for (uint CurPos=0;CurPos+4<DataSize;)
         {
+#ifdef USE_SSE_FILTERS
+          // Skip bytes, which cannot start the address, with vector compare.
+          uint NextPos=FindE8(SrcData,CurPos,DataSize-4,CmpByte2);
+          Data+=NextPos-CurPos;
+          CurPos=NextPos;
+          if (CurPos+4>=DataSize)
+            break;
+#endif
           byte CurByte=*(Data++);
           CurPos++;
           if (CurByte==0xe8 || CurByte==CmpByte2)
@@ -441,7 +504,6 @@ byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
       // It was turned on by default in 5.0 - 5.80b3 , so we still need it
       // here for compatibility with some of previously created archives.
       {
-        uint FileOffset=(uint)WrittenFileSize;
         // DataSize is unsigned, so we use "CurPos+3" and not "DataSize-3"
         // to avoid overflow for DataSize<3.
         for (uint CurPos=0;CurPos+3<DataSize;CurPos+=4)
@@ -464,8 +526,11 @@ byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
         // values here, since RAR5 uses only 5 bits to store channel.
         uint Channels=Flt->Channels,SrcPos=0;
 
-        FilterDstMemory.Alloc(DataSize);
-        byte *DstData=&FilterDstMemory[0];
+#ifdef USE_SSE_FILTERS
+        // We always get a copy of window data here, so it can be modified.
+        if (DeltaSIMD(Data,DataSize,Channels,DstData))
+          return DstData;
+#endif
 
         // Bytes from same channels are grouped to continual data blocks,
         // so we need to place them back to their interleaving positions.
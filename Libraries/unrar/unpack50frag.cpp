@@ -41,7 +41,10 @@ void FragmentedWindow::Init(size_t WinSize)
     byte *NewMem=NULL;
     while (Size>=MinSize)
     {
-      NewMem=(byte *)malloc(Size);
+      // Clean the window to generate the same output when unpacking corrupt
+      // RAR files, which may access to unused areas of sliding dictionary.
+      // calloc gets zero pages from OS without touching them.
+      NewMem=(byte *)calloc(Size,1);
       if (NewMem!=NULL)
         break;
       Size-=Size/32;
@@ -49,10 +52,6 @@ void FragmentedWindow::Init(size_t WinSize)
     if (NewMem==NULL)
       throw std::bad_alloc();
 
-    // Clean the window to generate the same output when unpacking corrupt
-    // RAR files, which may access to unused areas of sliding dictionary.
-    memset(NewMem,0,Size);
-
     Mem[BlockNum]=NewMem;
     TotalSize+=Size;
     MemSize[BlockNum]=TotalSize;
@@ -76,13 +75,32 @@ byte& FragmentedWindow::operator [](size_t Item)
 
 void FragmentedWindow::CopyString(uint Length,uint Distance,size_t &UnpPtr,size_t MaxWinMask)
 {
-  size_t SrcPtr=UnpPtr-Distance;
-  while (Length-- > 0)
+  size_t SrcPtr=(UnpPtr-Distance) & MaxWinMask;
+  while (Length>0)
   {
-    (*this)[UnpPtr]=(*this)[SrcPtr++ & MaxWinMask];
-    // We need to have masked UnpPtr after quit from loop, so it must not
-    // be replaced with '(*this)[UnpPtr++ & MaxWinMask]'
-    UnpPtr=(UnpPtr+1) & MaxWinMask;
+    // Copy the longest part, which is contiguous both in source and
+    // destination memory blocks. Window end is also a block end,
+    // so we do not need to mask pointers inside of such part.
+    size_t CopySize=GetBlockSize(UnpPtr,GetBlockSize(SrcPtr,Length));
+    if (CopySize==0) // Must never happen.
+      break;
+
+    byte *Src=&(*this)[SrcPtr];
+    byte *Dest=&(*this)[UnpPtr];
+    // Source and destination in different blocks never overlap,
+    // but blocks can be allocated in any order, so we check addresses.
+    if (Src<Dest)
+      CopyMatchData(Dest,Src,CopySize);
+    else
+      if (Src>=Dest+CopySize)
+        memcpy(Dest,Src,CopySize);
+      else
+        for (size_t I=0;I<CopySize;I++) // Can be here only for corrupt data.
+          Dest[I]=Src[I];
+
+    SrcPtr=(SrcPtr+CopySize) & MaxWinMask;
+    UnpPtr=(UnpPtr+CopySize) & MaxWinMask;
+    Length-=(uint)CopySize;
   }
 }
 
@@ -1,5 +1,22 @@
+// Minimum size of data read in one pass.
 #define UNP_READ_SIZE_MT        0x400000
+
+// Compressed data amount we try to give to every thread in one pass.
+// Number of blocks per thread is calculated from this value and actual
+// compressed block sizes.
+#define UNP_THREAD_DATA_MT       0x40000
 #define UNP_BLOCKS_PER_THREAD          2
+#define UNP_MAX_BLOCKS_PER_THREAD      4
+
+// Even getbits32 can read up to 3 additional bytes after current
+// and our block header and table reading code can look much further.
+// Let's allocate the additional space here, so we do not need to check
+// bounds for every bit field access.
+#define UNP_READ_OVERFLOW_MT         1024
+
+// Minimum filter data amount given to every thread when applying filters.
+// Smaller amounts are processed faster than threads are started.
+#define UNP_FILTER_DATA_MT       0x20000
 
 
 struct UnpackThreadDataList
@@ -17,38 +34,61 @@ THREAD_PROC(UnpackDecodeThread)
 }
 
 
+struct UnpackFilterListMT
+{
+  UnpackFilterMT *F;
+  uint FilterCount;
+};
+
+
+THREAD_PROC(UnpackFilterThread)
+{
+  UnpackFilterListMT *FL=(UnpackFilterListMT *)Data;
+  for (uint I=0;I<FL->FilterCount;I++)
+    FL->F->UnpackPtr->ApplyFilterMT(FL->F[I]);
+}
+
+
 void Unpack::InitMT()
 {
   if (ReadBufMT==NULL)
   {
-    // Even getbits32 can read up to 3 additional bytes after current
-    // and our block header and table reading code can look much further.
-    // Let's allocate the additional space here, so we do not need to check
-    // bounds for every bit field access.
-    const size_t Overflow=1024;
-
-    ReadBufMT=new byte[UNP_READ_SIZE_MT+Overflow];
-    memset(ReadBufMT,0,UNP_READ_SIZE_MT+Overflow);
+    // Read buffer must fit two passes of all threads. It is not smaller
+    // than UNP_READ_SIZE_MT, so up to 8 threads use the same 4 MB buffer.
+    ReadBufSizeMT=Max(UNP_READ_SIZE_MT,2*MaxUserThreads*UNP_THREAD_DATA_MT);
+    size_t AllocSize=ReadBufSizeMT+UNP_READ_OVERFLOW_MT;
+    ReadBufMT=(byte *)UnpBufPool.Get(AllocSize,true);
+    if (ReadBufMT==NULL)
+      ReadBufMT=(byte *)calloc(AllocSize,1);
+    if (ReadBufMT==NULL)
+      ErrHandler.MemoryError();
   }
   if (UnpThreadData==NULL)
   {
-    uint MaxItems=MaxUserThreads*UNP_BLOCKS_PER_THREAD;
+    // Decoded item buffers are allocated later, only for entries really
+    // used for decoding. We need two sets of entries for current
+    // and previous passes, see Unpack5MT() for details.
+    uint MaxItems=2*MaxUserThreads*UNP_MAX_BLOCKS_PER_THREAD;
     UnpThreadData=new UnpackThreadData[MaxItems];
     memset(UnpThreadData,0,sizeof(UnpackThreadData)*MaxItems);
+  }
+}
 
-    for (uint I=0;I<MaxItems;I++)
-    {
-      UnpackThreadData *CurData=UnpThreadData+I;
-      if (CurData->Decoded==NULL)
-      {
-        // Typical number of items in RAR blocks does not exceed 0x4000.
-        CurData->DecodedAllocated=0x4100;
-        // It will be freed in the object destructor, not in this file.
-        CurData->Decoded=(UnpackDecodedItem *)malloc(CurData->DecodedAllocated*sizeof(UnpackDecodedItem));
-        if (CurData->Decoded==NULL)
-          ErrHandler.MemoryError();
-      }
-    }
+
+void Unpack::InitDecodedMT(UnpackThreadData &D)
+{
+  if (D.Decoded==NULL)
+  {
+    // Typical number of items in RAR blocks does not exceed 0x4000.
+    D.DecodedAllocated=0x4100;
+    // It will be freed or returned to pool in the object destructor,
+    // not in this file.
+    size_t DecodedSize=D.DecodedAllocated*sizeof(UnpackDecodedItem);
+    D.Decoded=(UnpackDecodedItem *)UnpBufPool.Get(DecodedSize,false);
+    if (D.Decoded==NULL)
+      D.Decoded=(UnpackDecodedItem *)malloc(DecodedSize);
+    if (D.Decoded==NULL)
+      ErrHandler.MemoryError();
   }
 }
 
@@ -58,16 +98,34 @@ void Unpack::Unpack5MT(bool Solid)
   InitMT();
   UnpInitData(Solid);
 
-  for (uint I=0;I<MaxUserThreads*UNP_BLOCKS_PER_THREAD;I++)
+  // Threads can be still running if previous call was interrupted
+  // by exception when processing decoded data.
+  UnpThreadPool->WaitDone();
+
+  uint MaxItems=MaxUserThreads*UNP_MAX_BLOCKS_PER_THREAD;
+  for (uint I=0;I<2*MaxItems;I++)
   {
     UnpackThreadData *CurData=UnpThreadData+I;
     CurData->LargeBlock=false;
     CurData->Incomplete=false;
   }
 
-  UnpThreadData[0].BlockHeader=BlockHeader;
-  UnpThreadData[0].BlockTables=BlockTables;
-  uint LastBlockNum=0;
+  // Threads decode blocks of current pass, while we apply and write data
+  // decoded in previous pass. So we use two sets of thread data and swap
+  // them after every pass.
+  UnpackThreadData *CurSet=UnpThreadData,*PrevSet=UnpThreadData+MaxItems;
+
+  // Number of decoded, but not processed yet blocks in PrevSet.
+  uint PendingBlocks=0;
+
+  // Number of blocks per thread in one pass and read size depend
+  // on compressed block size, which we learn when processing blocks.
+  uint BlocksPerThread=UNP_BLOCKS_PER_THREAD;
+  size_t ReadSizeMT=UNP_READ_SIZE_MT;
+
+  CurSet[0].BlockHeader=BlockHeader;
+  CurSet[0].BlockTables=BlockTables;
+  UnpackThreadData *LastBlock=CurSet;
 
   int DataSize=0;
   int BlockStart=0;
@@ -78,14 +136,18 @@ void Unpack::Unpack5MT(bool Solid)
   // Large blocks could cause too high memory use in multithreaded mode.
   bool LargeBlock=false;
 
-  bool Done=false;
-  while (!Done)
+  // 'Done' is set when processing fails or file is complete, so we stop
+  // at once. If we fail to read a block header when collecting a pass,
+  // we set 'StopAfterPass' instead, because blocks preceding it and
+  // those pending from the previous pass still need to be processed.
+  bool Done=false,StopAfterPass=false;
+  while (!Done && !StopAfterPass)
   {
     // Data amount, which is guaranteed to fit block header and tables,
     // so we can safely read them without additional checks.
     const int TooSmallToProcess=1024;
 
-    int ReadSize=UnpIO->UnpRead(ReadBufMT+DataSize,(UNP_READ_SIZE_MT-DataSize)&~0xf);
+    int ReadSize=UnpIO->UnpRead(ReadBufMT+DataSize,(ReadSizeMT-DataSize)&~0xf);
     if (ReadSize<0)
       break;
     DataSize+=ReadSize;
@@ -97,14 +159,16 @@ void Unpack::Unpack5MT(bool Solid)
     if (ReadSize>0 && DataSize<TooSmallToProcess)
       continue;
 
-    while (BlockStart<DataSize && !Done)
+    while (BlockStart<DataSize && !Done && !StopAfterPass)
     {
       uint BlockNumber=0,BlockNumberMT=0;
-      while (BlockNumber<MaxUserThreads*UNP_BLOCKS_PER_THREAD)
+      size_t BlockDataMT=0; // Size of normal blocks processed in MT mode.
+      while (BlockNumber<MaxUserThreads*BlocksPerThread)
       {
-        UnpackThreadData *CurData=UnpThreadData+BlockNumber;
-        LastBlockNum=BlockNumber;
+        UnpackThreadData *CurData=CurSet+BlockNumber;
+        LastBlock=CurData;
         CurData->UnpackPtr=this;
+        InitDecodedMT(*CurData);
 
         // 'Incomplete' thread is present. This is a thread processing block
         // in the end of buffer, split between two read operations.
@@ -136,7 +200,7 @@ void Unpack::Unpack5MT(bool Solid)
           if (!ReadBlockHeader(CurData->Inp,CurData->BlockHeader) ||
               !CurData->BlockHeader.TablePresent && !TablesRead5)
           {
-            Done=true;
+            StopAfterPass=true;
             break;
           }
           TablesRead5=true;
@@ -149,7 +213,10 @@ void Unpack::Unpack5MT(bool Solid)
         if (LargeBlock || CurData->BlockHeader.BlockSize>LargeBlockSize)
           LargeBlock=CurData->LargeBlock=true;
         else
+        {
           BlockNumberMT++; // Number of normal blocks processed in MT mode.
+          BlockDataMT+=CurData->BlockHeader.HeaderSize+CurData->BlockHeader.BlockSize;
+        }
 
         BlockStart+=CurData->BlockHeader.HeaderSize+CurData->BlockHeader.BlockSize;
 
@@ -178,11 +245,13 @@ void Unpack::Unpack5MT(bool Solid)
       for (uint CurBlock=0;CurBlock<BlockNumberMT;CurBlock+=MaxBlockPerThread)
       {
         UnpackThreadDataList *UTD=UTDArray+UTDArrayPos++;
-        UTD->D=UnpThreadData+CurBlock;
+        UTD->D=CurSet+CurBlock;
         UTD->BlockCount=Min(MaxBlockPerThread,BlockNumberMT-CurBlock);
 
 #ifdef USE_THREADS
-        if (BlockNumber==1)
+        // Decode a single block in current thread only if we do not have
+        // previous pass data to process in parallel.
+        if (BlockNumber==1 && PendingBlocks==0)
           UnpackDecode(*UTD->D);
         else
           UnpThreadPool->AddTask(UnpackDecodeThread,(void*)UTD);
@@ -192,21 +261,64 @@ void Unpack::Unpack5MT(bool Solid)
 #endif
       }
 
+#ifdef USE_THREADS
+      UnpThreadPool->StartTasks();
+#endif
+
+      // Apply and write data of previous pass while threads are decoding
+      // the current pass. It uses only decoded data and window,
+      // so we can safely do it until threads are done.
+      for (uint Block=0;Block<PendingBlocks && !Done;Block++)
+        if (!ProcessDecoded(PrevSet[Block]))
+          Done=true;
+      PendingBlocks=0;
+
       if (BlockNumber==0)
         break;
 
+      // Adjust the next pass to average compressed block size. Small blocks
+      // are grouped to reduce the thread synchronization overhead.
+      // Read size is chosen to fit two passes and it is never decreased,
+      // so unprocessed data left in buffer always fit it.
+      if (BlockNumberMT>0)
+      {
+        size_t AvgBlockSize=Max(BlockDataMT/BlockNumberMT,1);
+        BlocksPerThread=(uint)Min(UNP_THREAD_DATA_MT/AvgBlockSize,UNP_MAX_BLOCKS_PER_THREAD);
+        BlocksPerThread=Max(BlocksPerThread,UNP_BLOCKS_PER_THREAD);
+        size_t PassSize=MaxUserThreads*BlocksPerThread*AvgBlockSize;
+        ReadSizeMT=Max(ReadSizeMT,Min(2*PassSize,ReadBufSizeMT));
+      }
+
 #ifdef USE_THREADS
       UnpThreadPool->WaitDone();
 #endif
 
+      if (Done) // Failed to process the previous pass.
+        break;
+
       bool IncompleteThread=false;
 
+      // Large blocks are decoded and processed in the same function and
+      // use the input buffer, so we process passes including them here.
+      // Passes with normal blocks only are processed in next loop iteration
+      // in parallel with decoding of next pass or after the loop.
+      bool ProcessNow=BlockNumberMT<BlockNumber;
+
       for (uint Block=0;Block<BlockNumber;Block++)
       {
-        UnpackThreadData *CurData=UnpThreadData+Block;
-        if (!CurData->LargeBlock && !ProcessDecoded(*CurData) ||
-            CurData->LargeBlock && !UnpackLargeBlock(*CurData) ||
-            CurData->DamagedData)
+        UnpackThreadData *CurData=CurSet+Block;
+        if (ProcessNow)
+        {
+          if (!CurData->LargeBlock && !ProcessDecoded(*CurData) ||
+              CurData->LargeBlock && !UnpackLargeBlock(*CurData))
+          {
+            Done=true;
+            break;
+          }
+        }
+        else
+          PendingBlocks=Block+1;
+        if (CurData->DamagedData)
         {
           Done=true;
           break;
@@ -227,18 +339,17 @@ void Unpack::Unpack5MT(bool Solid)
           CurData->Inp.InBuf=ReadBufMT;
           CurData->Inp.InAddr=0;
 
-          if (Block!=0)
-          {
-            // Move the incomplete thread entry to the first position,
-            // so we'll start processing from it. Preserve the original
-            // buffer for decoded data.
-            UnpackDecodedItem *Decoded=UnpThreadData[0].Decoded;
-            uint DecodedAllocated=UnpThreadData[0].DecodedAllocated;
-            UnpThreadData[0]=*CurData;
-            UnpThreadData[0].Decoded=Decoded;
-            UnpThreadData[0].DecodedAllocated=DecodedAllocated;
-            CurData->Incomplete=false;
-          }
+          // Move the incomplete thread entry to the first position of
+          // next pass set, so we'll start processing from it. Preserve
+          // the original buffer for decoded data, because data already
+          // decoded in this entry can be still waiting for processing.
+          UnpackThreadData *NextData=PrevSet;
+          UnpackDecodedItem *Decoded=NextData->Decoded;
+          uint DecodedAllocated=NextData->DecodedAllocated;
+          *NextData=*CurData;
+          NextData->Decoded=Decoded;
+          NextData->DecodedAllocated=DecodedAllocated;
+          CurData->Incomplete=false;
 
           BlockStart=0;
           DataSize-=BufPos;
@@ -252,7 +363,12 @@ void Unpack::Unpack5MT(bool Solid)
           }
       }
 
-      if (IncompleteThread || Done)
+      // Current pass becomes the previous one.
+      UnpackThreadData *Set=PrevSet;
+      PrevSet=CurSet;
+      CurSet=Set;
+
+      if (IncompleteThread || Done || StopAfterPass)
         break; // Current buffer is done, read more data or quit.
       else
       {
@@ -277,11 +393,17 @@ void Unpack::Unpack5MT(bool Solid)
       }
     }
   }
+
+  // Process the last pass.
+  for (uint Block=0;Block<PendingBlocks;Block++)
+    if (!ProcessDecoded(PrevSet[Block]))
+      break;
+
   UnpPtr&=MaxWinMask; // ProcessDecoded and maybe others can leave UnpPtr > MaxWinMask here.
   UnpWriteBuf();
 
-  BlockHeader=UnpThreadData[LastBlockNum].BlockHeader;
-  BlockTables=UnpThreadData[LastBlockNum].BlockTables;
+  BlockHeader=LastBlock->BlockHeader;
+  BlockTables=LastBlock->BlockTables;
 }
 
 
@@ -339,6 +461,40 @@ void Unpack::UnpackDecode(UnpackThreadData &D)
 
     UnpackDecodedItem *CurItem=D.Decoded+D.DecodedSize++;
 
+    // Try to decode two literals at once if we are not close to block end.
+    if (D.Inp.InAddr<ReadBorder-2)
+    {
+      uint Pair=DecodeLiteralPair(D.Inp,&D.BlockTables.LD);
+      if (Pair!=0)
+      {
+        if (D.DecodedSize>1)
+        {
+          UnpackDecodedItem *PrevItem=CurItem-1;
+          if (PrevItem->Type==UNPDT_LITERAL && PrevItem->Length<3)
+          {
+            PrevItem->Length++;
+            PrevItem->Literal[PrevItem->Length]=(byte)Pair;
+            if (PrevItem->Length<3)
+            {
+              PrevItem->Length++;
+              PrevItem->Literal[PrevItem->Length]=(byte)(Pair>>8);
+              D.DecodedSize--;
+              continue;
+            }
+            CurItem->Type=UNPDT_LITERAL;
+            CurItem->Literal[0]=(byte)(Pair>>8);
+            CurItem->Length=0;
+            continue;
+          }
+        }
+        CurItem->Type=UNPDT_LITERAL;
+        CurItem->Literal[0]=(byte)Pair;
+        CurItem->Literal[1]=(byte)(Pair>>8);
+        CurItem->Length=1;
+        continue;
+      }
+    }
+
     uint MainSlot=DecodeNumber(D.Inp,&D.BlockTables.LD);
     if (MainSlot<256)
     {
@@ -653,3 +809,106 @@ bool Unpack::UnpackLargeBlock(UnpackThreadData &D)
   }
   return true;
 }
+
+
+// Find filters, which UnpWriteBuf will apply for current write range,
+// and apply them in parallel. It follows UnpWriteBuf filter loop logic,
+// but does not modify filters or write data. UnpWriteBuf takes prepared
+// results from FiltersMT instead of applying these filters itself.
+void Unpack::ApplyFiltersMT()
+{
+  size_t WrittenBorder=WrPtr;
+  size_t WriteSizeLeft=(UnpPtr-WrittenBorder)&MaxWinMask;
+  size_t DataSize=0,DeltaSize=0;
+  for (size_t I=0;I<Filters.Size();I++)
+  {
+    UnpackFilter *flt=&Filters[I];
+    if (flt->Type==FILTER_NONE || flt->NextWindow)
+      continue;
+    uint BlockStart=flt->BlockStart;
+    uint BlockLength=flt->BlockLength;
+    if (((BlockStart-WrittenBorder)&MaxWinMask)<WriteSizeLeft)
+    {
+      WrittenBorder=BlockStart;
+      WriteSizeLeft=(UnpPtr-WrittenBorder)&MaxWinMask;
+      if (BlockLength>WriteSizeLeft) // Filter is processed next time.
+        break;
+      if (BlockLength>0)
+      {
+        UnpackFilterMT F;
+        F.Filter=*flt;
+        F.FilterIndex=I;
+        F.FileOffset=uint(WrittenFileSize+((BlockStart-WrPtr)&MaxWinMask));
+        F.SrcPos=DataSize;
+        F.DstPos=DeltaSize;
+        F.SrcData=F.DstData=F.OutMem=NULL;
+        F.UnpackPtr=this;
+        FiltersMT.Push(F);
+
+        DataSize+=BlockLength;
+        if (flt->Type==FILTER_DELTA)
+          DeltaSize+=BlockLength;
+        WrittenBorder=(BlockStart+BlockLength)&MaxWinMask;
+        WriteSizeLeft=(UnpPtr-WrittenBorder)&MaxWinMask;
+      }
+    }
+  }
+
+  uint FilterCount=(uint)FiltersMT.Size();
+  uint ThreadCount=(uint)Min(DataSize/UNP_FILTER_DATA_MT,MaxUserThreads);
+  ThreadCount=Min(ThreadCount,FilterCount);
+  if (ThreadCount<2)
+  {
+    // Not worth to start threads, let UnpWriteBuf apply these filters.
+    FiltersMT.SoftReset();
+    return;
+  }
+
+  FilterMemMT.Alloc(DataSize+DeltaSize);
+  for (uint I=0;I<FilterCount;I++)
+  {
+    UnpackFilterMT *F=&FiltersMT[I];
+    F->SrcData=&FilterMemMT[F->SrcPos];
+    F->DstData=F->Filter.Type==FILTER_DELTA ? &FilterMemMT[DataSize+F->DstPos]:NULL;
+  }
+
+  // Split filters to contiguous groups with similar data size.
+  UnpackFilterListMT FLArray[MaxPoolThreads];
+  uint FLArrayPos=0;
+  size_t GroupSize=DataSize/ThreadCount;
+  for (uint CurFilter=0;CurFilter<FilterCount;)
+  {
+    UnpackFilterListMT *FL=FLArray+FLArrayPos++;
+    FL->F=&FiltersMT[CurFilter];
+    uint FirstFilter=CurFilter;
+    size_t FLSize=0;
+    // Last group takes all remaining filters.
+    while (CurFilter<FilterCount && (FLSize<GroupSize || FLArrayPos==ThreadCount))
+      FLSize+=FiltersMT[CurFilter++].Filter.BlockLength;
+    FL->FilterCount=CurFilter-FirstFilter;
+  }
+
+#ifdef USE_THREADS
+  if (FilterThreadPool==NULL)
+    FilterThreadPool=new ThreadPool(MaxUserThreads);
+
+  // Process the last group in current thread while others are in pool.
+  for (uint I=0;I+1<FLArrayPos;I++)
+    FilterThreadPool->AddTask(UnpackFilterThread,(void*)(FLArray+I));
+  FilterThreadPool->StartTasks();
+  UnpackFilterThread((void*)(FLArray+FLArrayPos-1));
+  FilterThreadPool->WaitDone();
+#else
+  for (uint I=0;I<FLArrayPos;I++)
+    UnpackFilterThread((void*)(FLArray+I));
+#endif
+}
+
+
+void Unpack::ApplyFilterMT(UnpackFilterMT &F)
+{
+  // Window is not modified until all filters are applied, so we can
+  // read it here.
+  CopyWindowData(F.SrcData,F.Filter.BlockStart,F.Filter.BlockLength);
+  F.OutMem=ApplyFilter(F.SrcData,F.Filter.BlockLength,&F.Filter,F.FileOffset,F.DstData);
+}
@@ -0,0 +1,234 @@
+// SSE2 and AVX2 versions of RAR5 E8, E8E9 and DELTA filters.
+// In GCC and Clang we compile them with target attributes, so they do not
+// require any SSE compiler switches. Actual version is selected at runtime.
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+#include <immintrin.h>
+#include <cpuid.h>
+#define FILTER_TARGET(t) __attribute__((target(t)))
+#else
+#define FILTER_TARGET(t)
+#endif
+
+enum FILTER_SIMD {FILTER_SIMD_NONE,FILTER_SIMD_SSE2,FILTER_SIMD_AVX2};
+
+
+static FILTER_SIMD GetFilterSIMD()
+{
+#ifdef USE_SSE
+  if (_SSE_Version>=SSE_AVX2)
+    return FILTER_SIMD_AVX2;
+  return _SSE_Version>=SSE_SSE2 ? FILTER_SIMD_SSE2:FILTER_SIMD_NONE;
+#else
+  unsigned int A,B,C,D;
+  if (__get_cpuid(1,&A,&B,&C,&D)==0)
+    return FILTER_SIMD_NONE;
+  FILTER_SIMD SIMD=(D & bit_SSE2)!=0 ? FILTER_SIMD_SSE2:FILTER_SIMD_NONE;
+
+  // Besides the CPU support, AVX2 needs OS to preserve YMM registers.
+  if ((C & bit_OSXSAVE)!=0 && (C & bit_AVX)!=0 && __get_cpuid_max(0,NULL)>=7)
+  {
+    unsigned int XCR0,XCR0High;
+    __asm__ ("xgetbv" : "=a"(XCR0),"=d"(XCR0High) : "c"(0));
+    if ((XCR0 & 6)==6)
+    {
+      __cpuid_count(7,0,A,B,C,D);
+      if ((B & bit_AVX2)!=0)
+        SIMD=FILTER_SIMD_AVX2;
+    }
+  }
+  return SIMD;
+#endif
+}
+
+
+// Called only when applying filters, so it is not a part of global static
+// initialization and can use _SSE_Version.
+static FILTER_SIMD FilterSIMD()
+{
+  static const FILTER_SIMD SIMD=GetFilterSIMD();
+  return SIMD;
+}
+
+
+static inline uint FilterLowBit(uint Mask)
+{
+#ifdef _MSC_VER
+  unsigned long Pos;
+  _BitScanForward(&Pos,Mask);
+  return (uint)Pos;
+#else
+  return (uint)__builtin_ctz(Mask);
+#endif
+}
+
+
+FILTER_TARGET("sse2") static uint FindE8SSE2(const byte *Data,uint Pos,uint Limit,byte CmpByte2)
+{
+  const __m128i E8=_mm_set1_epi8((char)0xe8),Cmp2=_mm_set1_epi8((char)CmpByte2);
+  for (;Pos+16<=Limit;Pos+=16)
+  {
+    __m128i V=_mm_loadu_si128((const __m128i *)(Data+Pos));
+    uint Mask=(uint)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(V,E8),_mm_cmpeq_epi8(V,Cmp2)));
+    if (Mask!=0)
+      return Pos+FilterLowBit(Mask);
+  }
+  for (;Pos<Limit;Pos++)
+    if (Data[Pos]==0xe8 || Data[Pos]==CmpByte2)
+      return Pos;
+  return Limit;
+}
+
+
+FILTER_TARGET("avx2") static uint FindE8AVX2(const byte *Data,uint Pos,uint Limit,byte CmpByte2)
+{
+  const __m256i E8=_mm256_set1_epi8((char)0xe8),Cmp2=_mm256_set1_epi8((char)CmpByte2);
+  for (;Pos+32<=Limit;Pos+=32)
+  {
+    __m256i V=_mm256_loadu_si256((const __m256i *)(Data+Pos));
+    uint Mask=(uint)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(V,E8),_mm256_cmpeq_epi8(V,Cmp2)));
+    if (Mask!=0)
+      return Pos+FilterLowBit(Mask);
+  }
+  return FindE8SSE2(Data,Pos,Limit,CmpByte2);
+}
+
+
+// Return position of first 0xe8 or CmpByte2 byte in [Pos,Limit) range
+// or Limit if nothing is found.
+static uint FindE8(const byte *Data,uint Pos,uint Limit,byte CmpByte2)
+{
+  switch(FilterSIMD())
+  {
+    case FILTER_SIMD_AVX2:
+      return FindE8AVX2(Data,Pos,Limit,CmpByte2);
+    case FILTER_SIMD_SSE2:
+      return FindE8SSE2(Data,Pos,Limit,CmpByte2);
+    default:
+      for (;Pos<Limit;Pos++)
+        if (Data[Pos]==0xe8 || Data[Pos]==CmpByte2)
+          break;
+      return Min(Pos,Limit);
+  }
+}
+
+
+// Delta decoding of single channel: Dst[I]=Dst[I-1]-Src[I], starting
+// from 0. Src and Dst can be the same. Byte additions of preceding
+// elements are done with 1, 2, 4 and 8 byte shifts.
+FILTER_TARGET("sse2") static void DeltaChannelSSE2(const byte *Src,byte *Dst,size_t Size)
+{
+  byte PrevByte=0;
+  size_t I=0;
+  for (;I+16<=Size;I+=16)
+  {
+    __m128i V=_mm_loadu_si128((const __m128i *)(Src+I));
+    V=_mm_add_epi8(V,_mm_slli_si128(V,1));
+    V=_mm_add_epi8(V,_mm_slli_si128(V,2));
+    V=_mm_add_epi8(V,_mm_slli_si128(V,4));
+    V=_mm_add_epi8(V,_mm_slli_si128(V,8));
+    V=_mm_sub_epi8(_mm_set1_epi8((char)PrevByte),V);
+    _mm_storeu_si128((__m128i *)(Dst+I),V);
+    PrevByte=(byte)_mm_cvtsi128_si32(_mm_srli_si128(V,15));
+  }
+  for (;I<Size;I++)
+    Dst[I]=(PrevByte-=Src[I]);
+}
+
+
+FILTER_TARGET("avx2") static void DeltaChannelAVX2(const byte *Src,byte *Dst,size_t Size)
+{
+  const __m256i Last=_mm256_set1_epi8(15);
+  __m256i Prev=_mm256_setzero_si256();
+  size_t I=0;
+  for (;I+32<=Size;I+=32)
+  {
+    // Shifts are done inside of 128 bit lanes, so we add the sum
+    // of low lane to all bytes of high lane after that.
+    __m256i V=_mm256_loadu_si256((const __m256i *)(Src+I));
+    V=_mm256_add_epi8(V,_mm256_slli_si256(V,1));
+    V=_mm256_add_epi8(V,_mm256_slli_si256(V,2));
+    V=_mm256_add_epi8(V,_mm256_slli_si256(V,4));
+    V=_mm256_add_epi8(V,_mm256_slli_si256(V,8));
+    __m256i LowSum=_mm256_shuffle_epi8(V,Last);
+    V=_mm256_add_epi8(V,_mm256_permute2x128_si256(LowSum,LowSum,0x08));
+    V=_mm256_sub_epi8(Prev,V);
+    _mm256_storeu_si256((__m256i *)(Dst+I),V);
+    Prev=_mm256_permute4x64_epi64(_mm256_shuffle_epi8(V,Last),0xff);
+  }
+  byte PrevByte=(byte)_mm_cvtsi128_si32(_mm256_castsi256_si128(Prev));
+  for (;I<Size;I++)
+    Dst[I]=(PrevByte-=Src[I]);
+}
+
+
+// Place 2 or 4 decoded channels to their interleaving positions.
+// Return the number of processed bytes per channel.
+FILTER_TARGET("sse2") static size_t DeltaInterleaveSSE2(byte **Chn,uint Channels,size_t ChnSize,byte *Dst)
+{
+  size_t I=0;
+  if (Channels==2)
+    for (;I+16<=ChnSize;I+=16,Dst+=32)
+    {
+      __m128i V0=_mm_loadu_si128((const __m128i *)(Chn[0]+I));
+      __m128i V1=_mm_loadu_si128((const __m128i *)(Chn[1]+I));
+      _mm_storeu_si128((__m128i *)Dst,_mm_unpacklo_epi8(V0,V1));
+      _mm_storeu_si128((__m128i *)(Dst+16),_mm_unpackhi_epi8(V0,V1));
+    }
+  if (Channels==4)
+    for (;I+16<=ChnSize;I+=16,Dst+=64)
+    {
+      __m128i V0=_mm_loadu_si128((const __m128i *)(Chn[0]+I));
+      __m128i V1=_mm_loadu_si128((const __m128i *)(Chn[1]+I));
+      __m128i V2=_mm_loadu_si128((const __m128i *)(Chn[2]+I));
+      __m128i V3=_mm_loadu_si128((const __m128i *)(Chn[3]+I));
+      __m128i Lo01=_mm_unpacklo_epi8(V0,V1),Hi01=_mm_unpackhi_epi8(V0,V1);
+      __m128i Lo23=_mm_unpacklo_epi8(V2,V3),Hi23=_mm_unpackhi_epi8(V2,V3);
+      _mm_storeu_si128((__m128i *)Dst,_mm_unpacklo_epi16(Lo01,Lo23));
+      _mm_storeu_si128((__m128i *)(Dst+16),_mm_unpackhi_epi16(Lo01,Lo23));
+      _mm_storeu_si128((__m128i *)(Dst+32),_mm_unpacklo_epi16(Hi01,Hi23));
+      _mm_storeu_si128((__m128i *)(Dst+48),_mm_unpackhi_epi16(Hi01,Hi23));
+    }
+  return I;
+}
+
+
+// Decode DELTA filter data to DstData. Src data is modified, channels
+// are decoded in place before placing them to interleaving positions.
+// Return false if SIMD is not available.
+static bool DeltaSIMD(byte *Src,uint DataSize,uint Channels,byte *DstData)
+{
+  FILTER_SIMD SIMD=FilterSIMD();
+  if (SIMD==FILTER_SIMD_NONE || Channels>32)
+    return false;
+
+  // Bytes from same channels are grouped to continual data blocks.
+  // First DataSize%Channels channels are one byte longer than others.
+  byte *Chn[32];
+  size_t ChnSize[32];
+  byte *ChnData=Src;
+  for (uint CurChannel=0;CurChannel<Channels;CurChannel++)
+  {
+    Chn[CurChannel]=ChnData;
+    ChnSize[CurChannel]=CurChannel<DataSize ? (DataSize-CurChannel+Channels-1)/Channels:0;
+    byte *ChnDst=Channels==1 ? DstData:ChnData;
+    if (SIMD==FILTER_SIMD_AVX2)
+      DeltaChannelAVX2(ChnData,ChnDst,ChnSize[CurChannel]);
+    else
+      DeltaChannelSSE2(ChnData,ChnDst,ChnSize[CurChannel]);
+    ChnData+=ChnSize[CurChannel];
+  }
+  if (Channels<2)
+    return true;
+
+  size_t Done=0;
+  if (Channels==2 || Channels==4)
+    Done=DeltaInterleaveSSE2(Chn,Channels,ChnSize[Channels-1],DstData);
+  for (uint CurChannel=0;CurChannel<Channels;CurChannel++)
+  {
+    byte *Dst=DstData+Done*Channels+CurChannel;
+    for (size_t I=Done;I<ChnSize[CurChannel];I++,Dst+=Channels)
+      *Dst=Chn[CurChannel][I];
+  }
+  return true;
+}
@@ -6,9 +6,92 @@ _forceinline void Unpack::InsertOldDist(uint Distance)
   OldDist[0]=Distance;
 }
 
-#ifdef _MSC_VER
-#define FAST_MEMCPY
-#endif
+// Copy LZ match data inside of same memory block. Dest must be above Src.
+// If Dest-Src distance is less than Length, source and destination overlap
+// and we need to repeat already copied data like byte by byte copy does.
+_forceinline void CopyMatchData(byte *Dest,byte *Src,size_t Length)
+{
+  size_t Distance=Dest-Src;
+  if (Distance>=16)
+  {
+    // Source and destination of every 16 byte block do not overlap here.
+    // Compilers expand fixed size memcpy inline to wide SSE2, AVX
+    // or NEON loads and stores.
+    if (Distance>=32)
+      while (Length>=32)
+      {
+        memcpy(Dest,Src,32);
+        Src+=32;
+        Dest+=32;
+        Length-=32;
+      }
+    while (Length>=16)
+    {
+      memcpy(Dest,Src,16);
+      Src+=16;
+      Dest+=16;
+      Length-=16;
+    }
+  }
+  else
+    if (Distance==1)
+    {
+      // Run of same byte, which is typical for database and disk images.
+      memset(Dest,*Src,Length);
+      return;
+    }
+    else
+      if ((Distance==2 || Distance==4) && Length>=16)
+      {
+        // Pattern period divides 16, so we can store it as entire 16 byte
+        // blocks instead of repeating every byte.
+        byte Pattern[16];
+        for (uint I=0;I<ASIZE(Pattern);I++)
+          Pattern[I]=Src[I & (Distance-1)];
+        while (Length>=16)
+        {
+          memcpy(Dest,Pattern,16);
+          Dest+=16;
+          Length-=16;
+        }
+        Src=Dest-Distance;
+      }
+
+  if (Distance>=8)
+    while (Length>=8)
+    {
+      memcpy(Dest,Src,8);
+      Src+=8;
+      Dest+=8;
+      Length-=8;
+    }
+  else
+    while (Length>=8) // Overlapping strings.
+    {
+      Dest[0]=Src[0];
+      Dest[1]=Src[1];
+      Dest[2]=Src[2];
+      Dest[3]=Src[3];
+      Dest[4]=Src[4];
+      Dest[5]=Src[5];
+      Dest[6]=Src[6];
+      Dest[7]=Src[7];
+
+      Src+=8;
+      Dest+=8;
+      Length-=8;
+    }
+
+  // Unroll the loop for 0 - 7 bytes left. Note that we use nested "if"s.
+  if (Length>0) { Dest[0]=Src[0];
+  if (Length>1) { Dest[1]=Src[1];
+  if (Length>2) { Dest[2]=Src[2];
+  if (Length>3) { Dest[3]=Src[3];
+  if (Length>4) { Dest[4]=Src[4];
+  if (Length>5) { Dest[5]=Src[5];
+  if (Length>6) { Dest[6]=Src[6]; } } } } } } } // Close all nested "if"s.
+}
+
 
 _forceinline void Unpack::CopyString(uint Length,uint Distance)
 {
@@ -18,55 +101,13 @@ _forceinline void Unpack::CopyString(uint Length,uint Distance)
     // If we are not close to end of window, we do not need to waste time
     // to "& MaxWinMask" pointer protection.
 
+    // SrcPtr check above also excludes "UnpPtr-Distance" overflow,
+    // so Src is always below Dest here as CopyMatchData requires.
     byte *Src=Window+SrcPtr;
     byte *Dest=Window+UnpPtr;
     UnpPtr+=Length;
 
-#ifdef FAST_MEMCPY
-    if (Distance<Length) // Overlapping strings
-#endif
-      while (Length>=8)
-      {
-        Dest[0]=Src[0];
-        Dest[1]=Src[1];
-        Dest[2]=Src[2];
-        Dest[3]=Src[3];
-        Dest[4]=Src[4];
-        Dest[5]=Src[5];
-        Dest[6]=Src[6];
-        Dest[7]=Src[7];
-
-        Src+=8;
-        Dest+=8;
-        Length-=8;
-      }
-#ifdef FAST_MEMCPY
-    else
-      while (Length>=8)
-      {
-        // In theory we still could overlap here.
-        // Supposing Distance == MaxWinSize - 1 we have memcpy(Src, Src + 1, 8).
-        // But for real RAR archives Distance <= MaxWinSize - MAX_INC_LZ_MATCH
-        // always, so overlap here is impossible.
-
-        // This memcpy expanded inline by MSVC. We could also use uint64
-        // assignment, which seems to provide about the same speed.
-        memcpy(Dest,Src,8); 
-
-        Src+=8;
-        Dest+=8;
-        Length-=8;
-      }
-#endif
-
-    // Unroll the loop for 0 - 7 bytes left. Note that we use nested "if"s.
-    if (Length>0) { Dest[0]=Src[0];
-    if (Length>1) { Dest[1]=Src[1];
-    if (Length>2) { Dest[2]=Src[2];
-    if (Length>3) { Dest[3]=Src[3];
-    if (Length>4) { Dest[4]=Src[4];
-    if (Length>5) { Dest[5]=Src[5];
-    if (Length>6) { Dest[6]=Src[6]; } } } } } } } // Close all nested "if"s.
+    CopyMatchData(Dest,Src,Length);
   }
   else
     while (Length-- > 0) // Slow copying with all possible precautions.
@@ -124,6 +165,20 @@ _forceinline uint Unpack::DecodeNumber(BitInput &Inp,DecodeTable *Dec)
 }
 
 
+// Decode two literals at once if compressed data starts from two short
+// literal codes. Returns the first literal in lower 8 bits and the second
+// in next 8 bits. Returns 0 if there is no such pair, so the caller needs
+// to use DecodeNumber. Caller must ensure that at least
+// MAX_PAIR_DECODE_BITS bits are left in the current block.
+_forceinline uint Unpack::DecodeLiteralPair(BitInput &Inp,LiteralDecodeTable *Dec)
+{
+  uint PairData=Dec->PairData[Inp.getbits()>>(16-MAX_PAIR_DECODE_BITS)];
+  if (PairData!=0)
+    Inp.addbits(PairData>>16);
+  return PairData;
+}
+
+
 _forceinline uint Unpack::SlotToLength(BitInput &Inp,uint Slot)
 {
   uint LBits,Length=2;
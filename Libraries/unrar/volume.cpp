@@ -153,6 +153,8 @@ bool MergeArchive(Archive &Arc,ComprDataIO *DataIO,bool ShowFileName,wchar Comma
     Arc.ReadHeader();
   if (Arc.GetHeaderType()==HEAD_FILE)
   {
+    if (DataIO!=NULL) // Need the hash of next part.
+      Arc.ProcessLazyExtra();
     Arc.ConvertAttributes();
     Arc.Seek(Arc.NextBlockPos-Arc.FileHead.PackSize,SEEK_SET);
   }
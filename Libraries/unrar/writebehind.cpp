@@ -0,0 +1,154 @@
+#include "rar.hpp"
+
+#ifdef RAR_SMP
+
+THREAD_PROC(WriteBehindThread)
+{
+  FileWriteBehind::Block *B=(FileWriteBehind::Block *)Data;
+  B->Owner->WriteBlock(B);
+}
+
+
+FileWriteBehind::FileWriteBehind(size_t Size)
+{
+  BlockSize=Max(Size/ASIZE(Blocks),0x10000);
+  Pool=new ThreadPool(1);
+  DestFile=NULL;
+  WritePos=0;
+  CurBlock=0;
+  Queued=0;
+  for (uint I=0;I<ASIZE(Blocks);I++)
+  {
+    Block *B=Blocks+I;
+    B->Owner=this;
+    B->Size=0;
+    B->Pos=0;
+    B->Failed=false;
+  }
+}
+
+
+FileWriteBehind::~FileWriteBehind()
+{
+  delete Pool;
+}
+
+
+void FileWriteBehind::Start(File *Dest)
+{
+  DestFile=Dest;
+  WritePos=Dest->Tell();
+  CurBlock=0;
+  Queued=0;
+
+  // Background thread must not throw. We repeat failed writes in main
+  // thread to report errors.
+  DestFile->SetExceptions(false);
+}
+
+
+void FileWriteBehind::Write(const byte *Data,size_t Size)
+{
+  while (Size>0)
+  {
+    Block *B=Blocks+CurBlock;
+    if (B->Data.Size()<BlockSize)
+      B->Data.Alloc(BlockSize);
+    size_t CopySize=Min(Size,BlockSize-B->Size);
+    memcpy(&B->Data[B->Size],Data,CopySize);
+    B->Size+=CopySize;
+    Data+=CopySize;
+    Size-=CopySize;
+    if (B->Size==BlockSize)
+      Submit();
+  }
+}
+
+
+void FileWriteBehind::Submit()
+{
+  Block *B=Blocks+CurBlock;
+  B->Pos=WritePos;
+  B->Failed=false;
+  WritePos+=B->Size;
+  Pool->AddTask(WriteBehindThread,B);
+  Pool->StartTasks();
+  Queued++;
+  CurBlock=(CurBlock+1)%ASIZE(Blocks);
+
+  // Wait if next block to fill is still queued.
+  if (Queued==ASIZE(Blocks))
+    WaitBlocks(true);
+}
+
+
+// Wait until queued blocks are written and release them. If Repeat is true,
+// we write again all blocks starting from first failed, this time with
+// exceptions enabled, so errors are reported in main thread as usual.
+void FileWriteBehind::WaitBlocks(bool Repeat)
+{
+  Pool->WaitDone();
+  bool Failed=false;
+  for (uint I=0;I<Queued;I++)
+  {
+    Block *B=Blocks+(CurBlock+ASIZE(Blocks)-Queued+I)%ASIZE(Blocks);
+    Failed|=B->Failed;
+    if (Failed && Repeat)
+    {
+      DestFile->SetExceptions(true);
+      DestFile->Seek(B->Pos,SEEK_SET);
+      DestFile->Write(&B->Data[0],B->Size);
+      DestFile->SetExceptions(false);
+    }
+    B->Size=0;
+  }
+  Queued=0;
+}
+
+
+// Write remaining data and wait until all data is written.
+void FileWriteBehind::Finish()
+{
+  if (DestFile==NULL)
+    return;
+  if (Blocks[CurBlock].Size>0)
+    Submit();
+  WaitBlocks(true);
+  DestFile->SetExceptions(true);
+  DestFile=NULL;
+}
+
+
+// Wait for queued blocks without writing the rest and reporting errors.
+void FileWriteBehind::Cancel()
+{
+  if (DestFile==NULL)
+    return;
+  WaitBlocks(false);
+  Blocks[CurBlock].Size=0;
+  DestFile->SetExceptions(true);
+  DestFile=NULL;
+}
+
+
+// Called in background thread.
+void FileWriteBehind::WriteBlock(Block *B)
+{
+  B->Failed=!DestFile->Write(&B->Data[0],B->Size);
+}
+
+
+WriteBehindScope::WriteBehindScope(ComprDataIO *DataIO)
+{
+  WriteBehindScope::DataIO=DataIO;
+  DataIO->SetWriteBehind(true);
+}
+
+
+WriteBehindScope::~WriteBehindScope()
+{
+  DataIO->CancelWrite();
+  DataIO->SetWriteBehind(false);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _RAR_WRITEBEHIND_
+#define _RAR_WRITEBEHIND_
+
+#ifdef RAR_SMP
+
+// Writes unpacked data to destination file in background thread, so slow
+// disk does not stop unpacking. Data is copied to a queue of blocks, which
+// are written in the same order by single thread. When all blocks are
+// queued, main thread waits until they are written.
+class FileWriteBehind
+{
+  public:
+    struct Block
+    {
+      FileWriteBehind *Owner;
+      Array<byte> Data;
+      size_t Size;   // Size of data in block.
+      int64 Pos;     // Destination file position of block data.
+      bool Failed;   // Write error in background thread.
+    };
+  private:
+    void Submit();
+    void WaitBlocks(bool Repeat);
+
+    ThreadPool *Pool;
+    File *DestFile;
+    size_t BlockSize;
+    int64 WritePos;  // Destination position of next queued block.
+    uint CurBlock;   // Block filled by main thread.
+    uint Queued;     // Blocks queued after last wait.
+    Block Blocks[8];
+  public:
+    FileWriteBehind(size_t Size);
+    ~FileWriteBehind();
+    void Start(File *Dest);
+    void Write(const byte *Data,size_t Size);
+    void Finish();
+    void Cancel();
+    bool IsActive() {return DestFile!=NULL;}
+    void WriteBlock(Block *B);
+};
+
+
+// Permits background writes to destination file of DataIO while in scope.
+// Destructor waits for pending writes, also when leaving by exception,
+// so destination file is not destroyed while it is written.
+class WriteBehindScope
+{
+  private:
+    ComprDataIO *DataIO;
+  public:
+    WriteBehindScope(ComprDataIO *DataIO);
+    ~WriteBehindScope();
+};
+
+#endif
+
+#endif
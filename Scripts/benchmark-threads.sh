@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Measures how RAR5 extraction speed scales with the number of threads.
+# Builds the command line unrar from Libraries/unrar and tests the given
+# archive with -mt1, -mt2, -mt4 ... up to the maximum thread count.
+#
+# Usage: Scripts/benchmark-threads.sh archive.rar [max threads] [runs]
+
+if [ -z "$1" ]; then
+    echo "Usage: $0 archive.rar [max threads] [runs]"
+    exit 1
+fi
+
+ARCHIVE=$1
+MAX_THREADS=${2:-64}
+RUNS=${3:-3}
+
+SOURCE_DIR="$(cd "$(dirname "$0")/.." && pwd)/Libraries/unrar"
+BUILD_DIR=`mktemp -d -t unrar-benchmark.XXXXXX`
+trap "rm -rf \"$BUILD_DIR\"" EXIT
+
+echo "Building unrar in $BUILD_DIR"
+cp -R "$SOURCE_DIR/." "$BUILD_DIR"
+if ! make -C "$BUILD_DIR" unrar > "$BUILD_DIR/build.log" 2>&1; then
+    cat "$BUILD_DIR/build.log"
+    exit 1
+fi
+
+# Best wall clock time of $RUNS runs in milliseconds
+best_time() {
+    local best=""
+    for run in `seq $RUNS`; do
+        local start=`perl -MTime::HiRes=time -e 'printf "%d", time*1000'`
+        if ! "$BUILD_DIR/unrar" t -inul -mt$1 "$ARCHIVE"; then
+            echo "Testing $ARCHIVE with $1 threads failed" >&2
+            exit 1
+        fi
+        local end=`perl -MTime::HiRes=time -e 'printf "%d", time*1000'`
+        local elapsed=$((end - start))
+        if [ -z "$best" ] || [ $elapsed -lt $best ]; then
+            best=$elapsed
+        fi
+    done
+    echo $best
+}
+
+printf "%8s %10s %8s\n" "Threads" "Time (ms)" "Speedup"
+
+THREADS=1
+while [ $THREADS -le $MAX_THREADS ]; do
+    TIME=`best_time $THREADS` || exit 1
+    if [ $THREADS -eq 1 ]; then
+        BASE_TIME=$TIME
+    fi
+    awk -v t=$THREADS -v ms=$TIME -v base=$BASE_TIME \
+        'BEGIN { printf "%8d %10d %7.2fx\n", t, ms, (ms > 0 ? base / ms : 0) }'
+    THREADS=$((THREADS * 2))
+done
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Builds the UnRAR library from Libraries/unrar with its own makefile and
+# runs the C++ tests in Tests/Linux against the archives in Tests/Test Data.
+# Password protected and intentionally corrupted archives are skipped.
+#
+# Usage: Scripts/test-linux.sh [archive.rar ...]
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SOURCE_DIR="$ROOT_DIR/Libraries/unrar"
+BUILD_DIR=`mktemp -d -t unrar-linux-test.XXXXXX`
+trap "rm -rf \"$BUILD_DIR\"" EXIT
+
+echo "Building libunrar in $BUILD_DIR"
+cp -R "$SOURCE_DIR/." "$BUILD_DIR"
+if ! make -C "$BUILD_DIR" lib > "$BUILD_DIR/build.log" 2>&1; then
+    cat "$BUILD_DIR/build.log"
+    exit 1
+fi
+
+if [ $# -gt 0 ]; then
+    ARCHIVES=("$@")
+else
+    ARCHIVES=()
+    for ARCHIVE in "$ROOT_DIR/Tests/Test Data/"*.rar; do
+        case "`basename "$ARCHIVE"`" in
+            *Password*|"Modified CRC Archive.rar") ;;
+            *) ARCHIVES+=("$ARCHIVE") ;;
+        esac
+    done
+fi
+
+FAILED=0
+for TEST_SOURCE in "$ROOT_DIR/Tests/Linux/"*.cpp; do
+    TEST_NAME=`basename "$TEST_SOURCE" .cpp`
+    echo "Running $TEST_NAME"
+    if ! c++ -O2 -D_UNIX -I"$BUILD_DIR" -o "$BUILD_DIR/$TEST_NAME" "$TEST_SOURCE" \
+            "$BUILD_DIR/libunrar.a" -pthread; then
+        exit 1
+    fi
+    if ! "$BUILD_DIR/$TEST_NAME" "${ARCHIVES[@]}"; then
+        FAILED=1
+    fi
+done
+
+exit $FAILED
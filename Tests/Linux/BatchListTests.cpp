@@ -0,0 +1,187 @@
+//
+//  BatchListTests.cpp
+//  UnrarKit
+//
+//  Checks headers returned by RARListAll against headers read one by one
+//  with RARReadHeaderEx, in all open modes, with and without a header index
+//  file, and in a generated archive with a damaged header.
+//  Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+
+// Reads headers one by one with RARReadHeaderEx.
+static bool ReadHeaders(const char *path, unsigned int openMode, std::vector<Header> &headers)
+{
+    HANDLE arc = OpenArchive(path, openMode);
+    if (arc == NULL) {
+        return false;
+    }
+
+    RARHeaderDataEx data;
+    wchar_t redirName[1024];
+    int code;
+    while (true) {
+        memset(&data, 0, sizeof(data));
+        data.RedirName = redirName;
+        data.RedirNameSize = sizeof(redirName) / sizeof(redirName[0]);
+        if ((code = RARReadHeaderEx(arc, &data)) != ERAR_SUCCESS) {
+            break;
+        }
+        headers.push_back(MakeHeader(data));
+        if ((code = RARProcessFile(arc, RAR_SKIP, NULL, NULL)) != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return code == ERAR_END_ARCHIVE;
+}
+
+
+static void CheckList(const char *path, unsigned int openMode, const wchar_t *indexName,
+                      const std::vector<Header> &expected)
+{
+    HANDLE arc = OpenWithIndex(path, openMode, indexName);
+    CHECK(arc != NULL, "%s: cannot open", path);
+    if (arc == NULL) {
+        return;
+    }
+
+    RARList *list = NULL;
+    int code = RARListAll(arc, &list);
+    CHECK(code == ERAR_SUCCESS && list != NULL, "%s: RARListAll returned %d in mode %u", path, code, openMode);
+    if (list == NULL) {
+        RARCloseArchive(arc);
+        return;
+    }
+
+    CHECK(list->EntryCount == expected.size(), "%s: %u entries listed instead of %zu in mode %u",
+          path, list->EntryCount, expected.size(), openMode);
+    CHECK(list->NamesSize > 0 && list->Names[list->NamesSize - 1] == 0, "%s: names are not terminated", path);
+    for (size_t i = 0; i < list->EntryCount && i < expected.size(); i++) {
+        const RARListEntry &entry = list->Entries[i];
+        CHECK(entry.FileName < list->NamesSize && entry.ArcName < list->NamesSize &&
+              entry.RedirName < list->NamesSize && MakeHeader(*list, entry) == expected[i],
+              "%s: entry %zu differs in mode %u", path, i, openMode);
+    }
+
+    // Listed files are processed after selecting them by number.
+    if (list->EntryCount > 0 && openMode == RAR_OM_EXTRACT) {
+        RARHeaderDataEx data;
+        memset(&data, 0, sizeof(data));
+        unsigned int last = list->EntryCount - 1;
+        code = RARReadHeaderByIndex(arc, last, &data);
+        CHECK(code == ERAR_SUCCESS && Utf8(data.FileNameW) == list->Names + list->Entries[last].FileName,
+              "%s: wrong file found after listing", path);
+        code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        CHECK(code == ERAR_SUCCESS, "%s: testing listed file returned %d", path, code);
+    }
+
+    RARFreeList(list);
+    RARCloseArchive(arc);
+}
+
+
+// Headers preceding a damaged one are listed with error code, and
+// RARReadHeaderEx continues from the damaged header, not from the start.
+static void CheckDamagedList(const char *directory)
+{
+    int previousFailures = failures;
+    std::string path = std::string(directory) + "/damaged.rar";
+    std::vector<StoredFile> files = MakeRandomFiles(3, 1000);
+    Buffer archive;
+    PutMainHeader(archive);
+    size_t damagedPos = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (i == 1) {
+            damagedPos = archive.size();
+        }
+        PutFileHeader(archive, StoredHeader(files[i].name, files[i].data));
+        archive.insert(archive.end(), files[i].data.begin(), files[i].data.end());
+    }
+    PutEndHeader(archive);
+    archive[damagedPos + 4] ^= 0x55; // Header size.
+    CHECK(WriteFile(path.c_str(), archive), "%s: cannot write", path.c_str());
+
+    std::vector<Header> headers;
+    CHECK(!ReadHeaders(path.c_str(), RAR_OM_LIST_INCSPLIT, headers) && !headers.empty(),
+          "%s: damaged header not found", path.c_str());
+
+    HANDLE arc = OpenArchive(path.c_str(), RAR_OM_LIST_INCSPLIT);
+    CHECK(arc != NULL, "%s: cannot open", path.c_str());
+    if (arc == NULL) {
+        return;
+    }
+    RARList *list = NULL;
+    int code = RARListAll(arc, &list);
+    CHECK(code == ERAR_BAD_DATA && list != NULL && list->EntryCount == headers.size(),
+          "%s: RARListAll returned %d", path.c_str(), code);
+    for (size_t i = 0; list != NULL && i < list->EntryCount && i < headers.size(); i++) {
+        CHECK(MakeHeader(*list, list->Entries[i]) == headers[i], "%s: entry %zu differs", path.c_str(), i);
+    }
+
+    RARHeaderDataEx data;
+    memset(&data, 0, sizeof(data));
+    for (int i = 0; i < 3 && (code = RARReadHeaderEx(arc, &data)) != ERAR_END_ARCHIVE; i++) {
+        for (size_t j = 0; code == ERAR_SUCCESS && j < headers.size(); j++) {
+            CHECK(Utf8(data.FileNameW) != headers[j].fileName, "%s: %s read again after listing",
+                  path.c_str(), headers[j].fileName.c_str());
+        }
+        if (code == ERAR_SUCCESS) {
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+        }
+    }
+
+    RARFreeList(list);
+    RARCloseArchive(arc);
+    unlink(path.c_str());
+    PrintResult(path.c_str(), headers.size(), previousFailures);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    char directory[] = "/tmp/unrar-list-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+    std::string indexName = std::string(directory) + "/archive.idx";
+    std::wstring indexNameW(indexName.begin(), indexName.end());
+
+    CheckDamagedList(directory);
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        std::vector<Header> files, headers;
+        if (!ReadHeaders(argv[i], RAR_OM_LIST, files) || !ReadHeaders(argv[i], RAR_OM_LIST_INCSPLIT, headers)) {
+            CHECK(false, "%s: cannot open", argv[i]);
+            continue;
+        }
+
+        CheckList(argv[i], RAR_OM_LIST, NULL, files);
+        CheckList(argv[i], RAR_OM_LIST_INCSPLIT, NULL, headers);
+        CheckList(argv[i], RAR_OM_EXTRACT, NULL, files);
+
+        // First listing saves the index, next ones read it.
+        unlink(indexName.c_str());
+        CheckList(argv[i], RAR_OM_LIST_INCSPLIT, indexNameW.c_str(), headers);
+        ino_t inode = IndexInode(indexName.c_str());
+        CHECK(inode != 0, "%s: index not saved by listing", argv[i]);
+        CheckList(argv[i], RAR_OM_LIST_INCSPLIT, indexNameW.c_str(), headers);
+        CheckList(argv[i], RAR_OM_LIST, indexNameW.c_str(), files);
+        CheckList(argv[i], RAR_OM_EXTRACT, indexNameW.c_str(), files);
+        CHECK(IndexInode(indexName.c_str()) == inode, "%s: current index saved again", argv[i]);
+
+        unlink(indexName.c_str());
+        PrintResult(argv[i], headers.size(), previousFailures);
+    }
+    rmdir(directory);
+    return TestResult();
+}
@@ -0,0 +1,120 @@
+//
+//  ExtractToFileTests.cpp
+//  UnrarKit
+//
+//  Checks files extracted with RARProcessFile, also with unpacked data
+//  written in background, without checksums of stored files, with
+//  zero blocks left as holes and with data dropped from page cache,
+//  against data returned through the UCM_PROCESSDATA callback. Holes
+//  are checked in a generated archive with zero runs inside and at the
+//  end of a file.
+//  Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+
+static HANDLE OpenForExtraction(const char *path, unsigned int writeBehindMB, unsigned int opFlags)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, RAR_OM_EXTRACT, opFlags);
+    openData.WriteBehindMB = writeBehindMB;
+    return RAROpenArchiveEx(&openData);
+}
+
+
+// Extracts every file to its own name in directory and compares the result.
+// If expectHoles is true, all files must take less space than their size.
+static void ExtractToFiles(const char *path, const std::vector<Buffer> &expected, const char *directory,
+                           unsigned int writeBehindMB, unsigned int opFlags, bool expectHoles = false)
+{
+    HANDLE arc = OpenForExtraction(path, writeBehindMB, opFlags);
+    CHECK(arc != NULL, "%s: cannot open", path);
+    if (arc == NULL) {
+        return;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    size_t entry = 0;
+    while (RARReadHeaderEx(arc, &header) == ERAR_SUCCESS) {
+        if ((header.Flags & RHDF_DIRECTORY) != 0) {
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+            entry++;
+            continue;
+        }
+
+        char destName[1024];
+        snprintf(destName, sizeof(destName), "%s/entry%zu", directory, entry);
+        int code = RARProcessFile(arc, RAR_EXTRACT, NULL, destName);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction of %s returned %d", path, header.FileName, code);
+
+        Buffer data;
+        CHECK(ReadFile(destName, data), "%s: cannot read extracted %s", path, header.FileName);
+        CHECK(entry < expected.size() && data == expected[entry],
+              "%s: extracted %s differs from callback data (write behind %u MB, flags %u)",
+              path, header.FileName, writeBehindMB, opFlags);
+        struct stat st;
+        CHECK(!expectHoles || (stat(destName, &st) == 0 && st.st_blocks < st.st_size / 512),
+              "%s: extracted %s has no holes (write behind %u MB)", path, header.FileName, writeBehindMB);
+        unlink(destName);
+        entry++;
+    }
+    CHECK(entry == expected.size(), "%s: %zu entries, %zu with callback", path, entry, expected.size());
+    RARCloseArchive(arc);
+}
+
+
+// Stored files with zero blocks inside and at the end, which are left as
+// holes with ROADOF_SPARSE. One of them has only zeros.
+static void CheckSparseFiles(const char *directory)
+{
+    std::vector<StoredFile> files = MakeRandomFiles(2, 100000);
+    Buffer &data = files[0].data;
+    data.resize(100000 + 600000, 0);
+    for (size_t i = 0; i < 100000; i++) {
+        data.push_back((unsigned char)rand());
+    }
+    data.resize(18 * 0x10000, 0);
+    files[1].data.assign(4 * 0x10000, 0);
+
+    std::string path = std::string(directory) + "/sparse.rar";
+    CHECK(WriteFile(path.c_str(), MakeStoredArchive(files)), "%s: cannot write", path.c_str());
+
+    int previousFailures = failures;
+    std::vector<Buffer> expected;
+    CHECK(ExtractWithCallback(path.c_str(), expected), "%s: cannot open", path.c_str());
+    ExtractToFiles(path.c_str(), expected, directory, 0, ROADOF_SPARSE, true);
+    ExtractToFiles(path.c_str(), expected, directory, 1, ROADOF_SPARSE, true);
+    PrintResult(path.c_str(), expected.size(), previousFailures);
+    unlink(path.c_str());
+}
+
+
+int main(int argc, char *argv[])
+{
+    char directory[] = "/tmp/unrar-extract-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    CheckSparseFiles(directory);
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        std::vector<Buffer> expected;
+        if (!ExtractWithCallback(argv[i], expected)) {
+            CHECK(false, "%s: cannot open", argv[i]);
+            continue;
+        }
+
+        ExtractToFiles(argv[i], expected, directory, 0, 0);
+        ExtractToFiles(argv[i], expected, directory, 1, 0);
+        ExtractToFiles(argv[i], expected, directory, 0, ROADOF_SKIPSTOREDHASH);
+        ExtractToFiles(argv[i], expected, directory, 1, ROADOF_SPARSE);
+        ExtractToFiles(argv[i], expected, directory, 0, ROADOF_READNOCACHE | ROADOF_WRITENOCACHE | ROADOF_PREALLOC);
+        PrintResult(argv[i], expected.size(), previousFailures);
+    }
+    rmdir(directory);
+    return TestResult();
+}
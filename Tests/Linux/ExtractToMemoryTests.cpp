@@ -0,0 +1,98 @@
+//
+//  ExtractToMemoryTests.cpp
+//  UnrarKit
+//
+//  Checks RARProcessFileToMemory and RARProcessFileToMemoryV against data
+//  returned through the UCM_PROCESSDATA callback, also with packed data
+//  read ahead in background. Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+
+static HANDLE OpenForExtraction(const char *path, unsigned int readAheadMB)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, RAR_OM_EXTRACT);
+    openData.ReadAheadMB = readAheadMB;
+    return RAROpenArchiveEx(&openData);
+}
+
+
+// Unpacks all entries to memory and compares them with the callback results.
+// Non-zero chunkSize splits every buffer to a scatter list of such chunks.
+static void ExtractToMemory(const char *path, const std::vector<Buffer> &expected, size_t chunkSize,
+                            unsigned int readAheadMB = 0)
+{
+    HANDLE arc = OpenForExtraction(path, readAheadMB);
+    CHECK(arc != NULL, "%s: cannot open", path);
+    if (arc == NULL) {
+        return;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    size_t entry = 0;
+    while (RARReadHeaderEx(arc, &header) == ERAR_SUCCESS) {
+        unsigned long long size = ((unsigned long long)header.UnpSizeHigh << 32) | header.UnpSize;
+        Buffer data(size + 1, 0xcc);
+
+        if (size > 0) {
+            int code = RARProcessFileToMemory(arc, data.data(), size - 1);
+            CHECK(code == ERAR_SMALL_BUF, "%s: too small buffer for %s returned %d", path, header.FileName, code);
+        }
+
+        int code;
+        if (chunkSize == 0) {
+            code = RARProcessFileToMemory(arc, data.data(), size);
+        } else {
+            std::vector<RARUnpackBuffer> chunks;
+            for (size_t pos = 0; pos < size; pos += chunkSize) {
+                RARUnpackBuffer chunk;
+                chunk.Addr = data.data() + pos;
+                chunk.Size = size - pos < chunkSize ? size - pos : chunkSize;
+                chunks.push_back(chunk);
+            }
+            code = RARProcessFileToMemoryV(arc, chunks.data(), (unsigned int)chunks.size());
+        }
+        CHECK(code == ERAR_SUCCESS, "%s: memory extraction of %s returned %d", path, header.FileName, code);
+
+        CHECK(entry < expected.size(), "%s: more entries than with callback", path);
+        if (entry < expected.size()) {
+            const Buffer &original = expected[entry];
+            CHECK(original.size() == size &&
+                  memcmp(original.data(), data.data(), original.size()) == 0,
+                  "%s: %s differs from callback data (chunk size %zu)", path, header.FileName, chunkSize);
+        }
+        CHECK(data[size] == 0xcc, "%s: %s was written past the buffer end", path, header.FileName);
+        entry++;
+    }
+    CHECK(entry == expected.size(), "%s: %zu entries, %zu with callback", path, entry, expected.size());
+    RARCloseArchive(arc);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        std::vector<Buffer> expected;
+        if (!ExtractWithCallback(argv[i], expected)) {
+            CHECK(false, "%s: cannot open", argv[i]);
+            continue;
+        }
+
+        ExtractToMemory(argv[i], expected, 0);
+        ExtractToMemory(argv[i], expected, 1);
+        ExtractToMemory(argv[i], expected, 4093);
+        ExtractToMemory(argv[i], expected, 65536);
+        ExtractToMemory(argv[i], expected, 0, 1);
+        PrintResult(argv[i], expected.size(), previousFailures);
+    }
+    return TestResult();
+}
@@ -0,0 +1,144 @@
+//
+//  FileLookupTests.cpp
+//  UnrarKit
+//
+//  Checks files found with RARReadHeaderByName and RARReadHeaderByIndex
+//  against files read in archive order. Files are looked up in reverse
+//  order, so solid archives have to unpack preceding files again, with
+//  and without a header index file. Built and run on Linux by
+//  Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+
+struct Entry {
+    std::wstring name;
+    Header header;
+    Buffer data;
+};
+
+
+// Reads all files in archive order, skipping continued parts of split files
+// same as RAR_OM_LIST does.
+static bool ReadEntries(const char *path, std::vector<Entry> &entries)
+{
+    HANDLE arc = OpenArchive(path, RAR_OM_EXTRACT);
+    if (arc == NULL) {
+        return false;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    while (RARReadHeaderEx(arc, &header) == ERAR_SUCCESS) {
+        if ((header.Flags & RHDF_SPLITBEFORE) != 0) {
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+            continue;
+        }
+        Entry entry;
+        entry.name = header.FileNameW;
+        entry.header = MakeHeader(header);
+        entries.push_back(entry);
+        RARSetCallback(arc, CopyDataCallback, (LPARAM)&entries.back().data);
+        int code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction of %s returned %d", path, header.FileName, code);
+    }
+    RARCloseArchive(arc);
+    return true;
+}
+
+
+// Finds every file in reverse order and compares its header and data.
+static void CheckLookups(const char *path, const std::vector<Entry> &entries, unsigned int openMode,
+                         const wchar_t *indexName, bool byName)
+{
+    HANDLE arc = OpenWithIndex(path, openMode, indexName);
+    CHECK(arc != NULL, "%s: cannot open", path);
+    if (arc == NULL) {
+        return;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    for (size_t i = entries.size(); i-- > 0;) {
+        const Entry &entry = entries[i];
+        int code = byName ? RARReadHeaderByName(arc, entry.name.c_str(), &header)
+                          : RARReadHeaderByIndex(arc, (unsigned int)i, &header);
+        CHECK(code == ERAR_SUCCESS && MakeHeader(header) == entry.header,
+              "%s: lookup of %ls returned %d, %ls in mode %u", path, entry.name.c_str(), code, header.FileNameW,
+              openMode);
+        if (code != ERAR_SUCCESS || openMode != RAR_OM_EXTRACT) {
+            continue;
+        }
+        Buffer data;
+        RARSetCallback(arc, CopyDataCallback, (LPARAM)&data);
+        code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        CHECK(code == ERAR_SUCCESS && data == entry.data, "%s: extraction of found %ls returned %d",
+              path, entry.name.c_str(), code);
+    }
+
+    // After finding a file, next file is returned by RARReadHeaderEx.
+    if (entries.size() > 1) {
+        int code = RARReadHeaderByIndex(arc, 0, &header);
+        while (code == ERAR_SUCCESS) {
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+            code = RARReadHeaderEx(arc, &header);
+            if ((header.Flags & RHDF_SPLITBEFORE) == 0) {
+                break;
+            }
+        }
+        CHECK(code == ERAR_SUCCESS && entries[1].name == header.FileNameW,
+              "%s: wrong file read after lookup in mode %u", path, openMode);
+    }
+
+    CHECK(RARReadHeaderByName(arc, L"no such file", &header) == ERAR_END_ARCHIVE,
+          "%s: missing file found in mode %u", path, openMode);
+    CHECK(RARReadHeaderByIndex(arc, (unsigned int)entries.size(), &header) == ERAR_END_ARCHIVE,
+          "%s: file found after the last one in mode %u", path, openMode);
+    RARCloseArchive(arc);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    char directory[] = "/tmp/unrar-lookup-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+    std::string indexName = std::string(directory) + "/archive.idx";
+    std::wstring indexNameW(indexName.begin(), indexName.end());
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        std::vector<Entry> entries;
+        if (!ReadEntries(argv[i], entries)) {
+            CHECK(false, "%s: cannot open", argv[i]);
+            continue;
+        }
+
+        CheckLookups(argv[i], entries, RAR_OM_EXTRACT, NULL, true);
+        CheckLookups(argv[i], entries, RAR_OM_EXTRACT, NULL, false);
+        CheckLookups(argv[i], entries, RAR_OM_LIST, NULL, true);
+        CheckLookups(argv[i], entries, RAR_OM_LIST_INCSPLIT, NULL, false);
+
+        // First lookup saves the index, next archive handles load it.
+        unlink(indexName.c_str());
+        CheckLookups(argv[i], entries, RAR_OM_EXTRACT, indexNameW.c_str(), true);
+        ino_t inode = IndexInode(indexName.c_str());
+        CHECK(inode != 0, "%s: index not saved by lookup", argv[i]);
+        CheckLookups(argv[i], entries, RAR_OM_EXTRACT, indexNameW.c_str(), false);
+        CheckLookups(argv[i], entries, RAR_OM_LIST, indexNameW.c_str(), true);
+        CHECK(IndexInode(indexName.c_str()) == inode, "%s: current index saved again", argv[i]);
+
+        unlink(indexName.c_str());
+        PrintResult(argv[i], entries.size(), previousFailures);
+    }
+    rmdir(directory);
+    return TestResult();
+}
@@ -0,0 +1,149 @@
+//
+//  HeaderIndexTests.cpp
+//  UnrarKit
+//
+//  Checks headers listed through a header index file against headers
+//  read from the archive, in both listing modes. The index must be saved
+//  only by a complete listing, used by next listings and saved again after
+//  the archive or the index changes. Built and run on Linux by
+//  Scripts/test-linux.sh
+//
+
+#include <fcntl.h>
+
+#include "TestSupport.h"
+
+
+// Lists headers of archive, using index file if indexName is not NULL.
+// If maxCount is not 0, listing stops after so many headers.
+static bool ListHeaders(const char *path, unsigned int openMode, const wchar_t *indexName,
+                        std::vector<Header> &headers, size_t maxCount = 0)
+{
+    HANDLE arc = OpenWithIndex(path, openMode, indexName);
+    if (arc == NULL) {
+        return false;
+    }
+
+    RARHeaderDataEx data;
+    wchar_t redirName[1024];
+    int code;
+    while (true) {
+        memset(&data, 0, sizeof(data));
+        data.RedirName = redirName;
+        data.RedirNameSize = sizeof(redirName) / sizeof(redirName[0]);
+        if ((code = RARReadHeaderEx(arc, &data)) != ERAR_SUCCESS) {
+            break;
+        }
+        headers.push_back(MakeHeader(data));
+        if (headers.size() == maxCount) {
+            code = ERAR_END_ARCHIVE;
+            break;
+        }
+        if ((code = RARProcessFile(arc, RAR_SKIP, NULL, NULL)) != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return code == ERAR_END_ARCHIVE;
+}
+
+
+static bool CopyFile(const char *source, const char *dest)
+{
+    Buffer data;
+    return ReadFile(source, data) && WriteFile(dest, data);
+}
+
+
+static void CheckListing(const char *path, const char *arcCopy, const char *indexName, const wchar_t *indexNameW,
+                         unsigned int openMode)
+{
+    std::vector<Header> expected;
+    CHECK(ListHeaders(arcCopy, openMode, NULL, expected), "%s: listing without index failed", path);
+
+    // Incomplete listing must not save the index.
+    unlink(indexName);
+    std::vector<Header> partial;
+    ListHeaders(arcCopy, openMode, indexNameW, partial, 1);
+    CHECK(IndexInode(indexName) == 0, "%s: index saved by incomplete listing", path);
+
+    std::vector<Header> created;
+    CHECK(ListHeaders(arcCopy, openMode, indexNameW, created) && created == expected,
+          "%s: headers differ when creating index in mode %u", path, openMode);
+    ino_t inode = IndexInode(indexName);
+    CHECK(inode != 0, "%s: index not saved in mode %u", path, openMode);
+
+    std::vector<Header> loaded;
+    CHECK(ListHeaders(arcCopy, openMode, indexNameW, loaded) && loaded == expected,
+          "%s: headers differ when reading index in mode %u", path, openMode);
+    CHECK(IndexInode(indexName) == inode, "%s: current index saved again in mode %u", path, openMode);
+
+    // Changed modification time makes the index stale.
+    struct stat st;
+    stat(arcCopy, &st);
+    struct timespec times[2] = {{0, UTIME_OMIT}, {st.st_mtim.tv_sec + 1, st.st_mtim.tv_nsec}};
+    utimensat(AT_FDCWD, arcCopy, times, 0);
+    std::vector<Header> stale;
+    CHECK(ListHeaders(arcCopy, openMode, indexNameW, stale) && stale == expected,
+          "%s: headers differ with stale index in mode %u", path, openMode);
+    CHECK(IndexInode(indexName) != inode, "%s: stale index not saved again in mode %u", path, openMode);
+    inode = IndexInode(indexName);
+
+    // Damaged index is ignored.
+    FILE *index = fopen(indexName, "r+b");
+    if (index != NULL) {
+        fseek(index, 12, SEEK_SET);
+        int c = fgetc(index);
+        fseek(index, 12, SEEK_SET);
+        fputc(c ^ 0x55, index);
+        fclose(index);
+    }
+    std::vector<Header> damaged;
+    CHECK(ListHeaders(arcCopy, openMode, indexNameW, damaged) && damaged == expected,
+          "%s: headers differ with damaged index in mode %u", path, openMode);
+    CHECK(IndexInode(indexName) != inode, "%s: damaged index not saved again in mode %u", path, openMode);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    char directory[] = "/tmp/unrar-index-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+    std::string arcCopy = std::string(directory) + "/archive.rar";
+    std::string indexName = std::string(directory) + "/archive.idx";
+    std::wstring indexNameW(indexName.begin(), indexName.end());
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        std::vector<Header> headers;
+        if (!CopyFile(argv[i], arcCopy.c_str()) || !ListHeaders(arcCopy.c_str(), RAR_OM_LIST_INCSPLIT, NULL, headers)) {
+            CHECK(false, "%s: cannot open", argv[i]);
+            continue;
+        }
+
+        CheckListing(argv[i], arcCopy.c_str(), indexName.c_str(), indexNameW.c_str(), RAR_OM_LIST);
+        CheckListing(argv[i], arcCopy.c_str(), indexName.c_str(), indexNameW.c_str(), RAR_OM_LIST_INCSPLIT);
+
+        // Index of all headers serves both modes.
+        std::vector<Header> expected, loaded;
+        ino_t inode = IndexInode(indexName.c_str());
+        ListHeaders(arcCopy.c_str(), RAR_OM_LIST, NULL, expected);
+        CHECK(ListHeaders(arcCopy.c_str(), RAR_OM_LIST, indexNameW.c_str(), loaded) && loaded == expected,
+              "%s: headers differ when listing with index of all headers", argv[i]);
+        CHECK(IndexInode(indexName.c_str()) == inode, "%s: index of all headers not used", argv[i]);
+
+        unlink(arcCopy.c_str());
+        unlink(indexName.c_str());
+        PrintResult(argv[i], headers.size(), previousFailures);
+    }
+    rmdir(directory);
+    return TestResult();
+}
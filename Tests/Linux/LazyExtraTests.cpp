@@ -0,0 +1,225 @@
+//
+//  LazyExtraTests.cpp
+//  UnrarKit
+//
+//  Checks headers and data read with ROADOF_LAZYEXTRA against those read
+//  without it. Times, hash and link target of RAR5 files may be missing
+//  in lazy headers, all other fields must be the same. Extracted data is
+//  verified with the full header, and an index file saved in lazy mode
+//  has all fields. A generated RAR5 archive with time and BLAKE2 records
+//  checks that lazy headers miss them, while extraction sets the time and
+//  detects a wrong hash. Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestInternals.h"
+
+
+// Lazy header must match the full one, except for fields missing in it.
+static bool MatchesLazy(const Header &full, const Header &lazy)
+{
+    if (full.arcName != lazy.arcName || full.fileName != lazy.fileName || full.fileNameA != lazy.fileNameA ||
+        (full.redirName != lazy.redirName && !lazy.redirName.empty()) ||
+        memcmp(full.fields, lazy.fields, sizeof(full.fields)) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < LAZY_FIELD_COUNT; i++) {
+        if (lazy.lazyFields[i] != full.lazyFields[i] && lazy.lazyFields[i] != 0) {
+            return false;
+        }
+    }
+    return lazy.lazyFields[LAZY_HASHTYPE] == RAR_HASH_NONE || memcmp(full.hash, lazy.hash, sizeof(full.hash)) == 0;
+}
+
+
+// Reads headers of all files. In RAR_OM_EXTRACT mode also tests them
+// and stores their data.
+static bool ReadArchive(const char *path, unsigned int openMode, unsigned int opFlags, const wchar_t *indexName,
+                        std::vector<Header> &headers, std::vector<Buffer> *contents = NULL)
+{
+    HANDLE arc = OpenWithIndex(path, openMode, indexName, opFlags);
+    if (arc == NULL) {
+        return false;
+    }
+
+    RARHeaderDataEx data;
+    wchar_t redirName[1024];
+    memset(&data, 0, sizeof(data));
+    data.RedirName = redirName;
+    data.RedirNameSize = sizeof(redirName) / sizeof(redirName[0]);
+    int code;
+    while ((code = RARReadHeaderEx(arc, &data)) == ERAR_SUCCESS) {
+        headers.push_back(MakeHeader(data));
+        if (contents == NULL) {
+            code = RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+        } else {
+            contents->push_back(Buffer());
+            RARSetCallback(arc, CopyDataCallback, (LPARAM)&contents->back());
+            code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+            CHECK(code == ERAR_SUCCESS, "%s: testing %ls returned %d with flags %x", path, data.FileNameW,
+                  code, opFlags);
+        }
+        if (code != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return code == ERAR_END_ARCHIVE;
+}
+
+
+static void CheckArchive(const char *path, const std::string &indexName, const std::wstring &indexNameW)
+{
+    int previousFailures = failures;
+    std::vector<Header> headers;
+    if (!ReadArchive(path, RAR_OM_LIST_INCSPLIT, 0, NULL, headers)) {
+        CHECK(false, "%s: cannot open", path);
+        return;
+    }
+
+    std::vector<Header> lazyHeaders;
+    CHECK(ReadArchive(path, RAR_OM_LIST_INCSPLIT, ROADOF_LAZYEXTRA, NULL, lazyHeaders) &&
+          lazyHeaders.size() == headers.size(), "%s: lazy listing failed", path);
+    for (size_t j = 0; j < lazyHeaders.size() && j < headers.size(); j++) {
+        CHECK(MatchesLazy(headers[j], lazyHeaders[j]), "%s: lazy header of %s differs",
+              path, headers[j].fileName.c_str());
+    }
+
+    std::vector<Header> extracted, lazyExtracted;
+    std::vector<Buffer> contents, lazyContents;
+    ReadArchive(path, RAR_OM_EXTRACT, 0, NULL, extracted, &contents);
+    CHECK(ReadArchive(path, RAR_OM_EXTRACT, ROADOF_LAZYEXTRA, NULL, lazyExtracted, &lazyContents) &&
+          lazyContents == contents, "%s: lazy extraction differs", path);
+
+    // Saved index has all fields, though listing is lazy.
+    unlink(indexName.c_str());
+    std::vector<Header> created, loaded;
+    CHECK(ReadArchive(path, RAR_OM_LIST_INCSPLIT, ROADOF_LAZYEXTRA, indexNameW.c_str(), created) &&
+          created == headers, "%s: lazy headers differ when creating index", path);
+    CHECK(ReadArchive(path, RAR_OM_LIST_INCSPLIT, 0, indexNameW.c_str(), loaded) && loaded == headers,
+          "%s: headers differ when reading index created in lazy mode", path);
+
+    unlink(indexName.c_str());
+    PrintResult(path, headers.size(), previousFailures);
+}
+
+
+// Stored files without CRC32, so only BLAKE2 records verify their data.
+static Buffer MakeHashedArchive(const std::vector<StoredFile> &files, bool damageHash)
+{
+    Buffer archive;
+    archive.reserve(0x10000); // Silences a false -Wstringop-overflow of GCC 12.
+    PutMainHeader(archive);
+    for (size_t i = 0; i < files.size(); i++) {
+        StoredHeader header(files[i].name, files[i].data);
+        header.crcPresent = false;
+
+        Buffer timeFields;
+        PutVInt(timeFields, FHEXTRA_HTIME_UNIXTIME | FHEXTRA_HTIME_MTIME);
+        Put32(timeFields, files[i].mtime);
+        PutExtraRecord(header.extra, FHEXTRA_HTIME, timeFields);
+
+        Buffer hashFields = HashRecordFields(files[i].data);
+        if (damageHash) {
+            hashFields.back() ^= 1;
+        }
+        PutExtraRecord(header.extra, FHEXTRA_HASH, hashFields);
+
+        PutFileHeader(archive, header);
+        archive.insert(archive.end(), files[i].data.begin(), files[i].data.end());
+    }
+    PutEndHeader(archive);
+    return archive;
+}
+
+
+// Processes all files with RAR_EXTRACT to directory or with RAR_TEST if it is NULL.
+// Returns the first error.
+static int ProcessArchive(const char *path, unsigned int opFlags, const char *directory)
+{
+    HANDLE arc = OpenArchive(path, RAR_OM_EXTRACT, opFlags);
+    if (arc == NULL) {
+        return ERAR_EOPEN;
+    }
+
+    RARHeaderDataEx data;
+    memset(&data, 0, sizeof(data));
+    int code, result = ERAR_SUCCESS;
+    while ((code = RARReadHeaderEx(arc, &data)) == ERAR_SUCCESS) {
+        code = RARProcessFile(arc, directory != NULL ? RAR_EXTRACT : RAR_TEST, (char *)directory, NULL);
+        if (code != ERAR_SUCCESS && result == ERAR_SUCCESS) {
+            result = code;
+        }
+    }
+    RARCloseArchive(arc);
+    return result != ERAR_SUCCESS || code == ERAR_END_ARCHIVE ? result : code;
+}
+
+
+static void CheckHashedArchive(const char *directory, const std::string &indexName, const std::wstring &indexNameW)
+{
+    std::vector<StoredFile> files = MakeRandomFiles(3, 20000);
+    std::string path = std::string(directory) + "/hashed.rar";
+    std::string damagedPath = std::string(directory) + "/damaged.rar";
+    CHECK(WriteFile(path.c_str(), MakeHashedArchive(files, false)) &&
+          WriteFile(damagedPath.c_str(), MakeHashedArchive(files, true)), "%s: cannot write", directory);
+
+    CheckArchive(path.c_str(), indexName, indexNameW);
+
+    int previousFailures = failures;
+    std::vector<Header> headers, lazyHeaders;
+    CHECK(ReadArchive(path.c_str(), RAR_OM_LIST_INCSPLIT, 0, NULL, headers) && headers.size() == files.size() &&
+          ReadArchive(path.c_str(), RAR_OM_LIST_INCSPLIT, ROADOF_LAZYEXTRA, NULL, lazyHeaders) &&
+          lazyHeaders.size() == files.size(), "%s: listing failed", path.c_str());
+    for (size_t i = 0; i < headers.size() && i < lazyHeaders.size(); i++) {
+        CHECK(headers[i].lazyFields[LAZY_FILETIME] != 0 && headers[i].lazyFields[LAZY_MTIME] != 0 &&
+              headers[i].lazyFields[LAZY_HASHTYPE] == RAR_HASH_BLAKE2, "%s: time or hash of %s not read",
+              path.c_str(), headers[i].fileName.c_str());
+        CHECK(lazyHeaders[i].lazyFields[LAZY_FILETIME] == 0 && lazyHeaders[i].lazyFields[LAZY_MTIME] == 0 &&
+              lazyHeaders[i].lazyFields[LAZY_HASHTYPE] == RAR_HASH_NONE,
+              "%s: time or hash of %s decoded in lazy header", path.c_str(), headers[i].fileName.c_str());
+    }
+
+    // Records missing in lazy headers are still used for the extracted files.
+    std::string extractDir = std::string(directory) + "/extracted";
+    CHECK(mkdir(extractDir.c_str(), 0755) == 0, "%s: cannot create", extractDir.c_str());
+    int code = ProcessArchive(path.c_str(), ROADOF_LAZYEXTRA, extractDir.c_str());
+    CHECK(code == ERAR_SUCCESS, "%s: lazy extraction returned %d", path.c_str(), code);
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string destName = extractDir + "/" + files[i].name;
+        Buffer data;
+        struct stat st;
+        CHECK(ReadFile(destName.c_str(), data) && data == files[i].data, "%s: wrong data", destName.c_str());
+        CHECK(stat(destName.c_str(), &st) == 0 && st.st_mtime == (time_t)files[i].mtime,
+              "%s: modification time not set", destName.c_str());
+        unlink(destName.c_str());
+    }
+    rmdir(extractDir.c_str());
+
+    for (unsigned int opFlags = 0; opFlags <= ROADOF_LAZYEXTRA; opFlags += ROADOF_LAZYEXTRA) {
+        code = ProcessArchive(damagedPath.c_str(), opFlags, NULL);
+        CHECK(code == ERAR_BAD_DATA, "%s: testing returned %d with flags %x", damagedPath.c_str(), code, opFlags);
+    }
+
+    unlink(path.c_str());
+    unlink(damagedPath.c_str());
+    PrintResult(damagedPath.c_str(), files.size(), previousFailures);
+}
+
+
+int main(int argc, char *argv[])
+{
+    char directory[] = "/tmp/unrar-lazy-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+    std::string indexName = std::string(directory) + "/archive.idx";
+    std::wstring indexNameW(indexName.begin(), indexName.end());
+
+    CheckHashedArchive(directory, indexName, indexNameW);
+    for (int i = 1; i < argc; i++) {
+        CheckArchive(argv[i], indexName, indexNameW);
+    }
+    rmdir(directory);
+    return TestResult();
+}
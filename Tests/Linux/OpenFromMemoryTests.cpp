@@ -0,0 +1,138 @@
+//
+//  OpenFromMemoryTests.cpp
+//  UnrarKit
+//
+//  Checks archives opened from memory blocks with RAROpenArchiveDataEx
+//  ArcData and memory mapped with ROADOF_MMAP against the same archives
+//  opened from files. Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+struct Entry {
+    std::string name;
+    Buffer data;
+};
+
+
+// Opens the archive from the path, or from arcData if it isn't NULL, and
+// unpacks all entries. Returns the RAROpenArchiveEx or the first error code.
+static int ExtractAll(const char *path, const Buffer *arcData, unsigned int openMode, std::vector<Entry> &entries,
+                      unsigned int opFlags = 0, unsigned int *flags = NULL)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, openMode, opFlags);
+    if (arcData != NULL) {
+        openData.ArcData = (void *)arcData->data();
+        openData.ArcDataSize = arcData->size();
+    }
+
+    HANDLE arc = RAROpenArchiveEx(&openData);
+    if (arc == NULL) {
+        return openData.OpenResult;
+    }
+    if (flags != NULL) {
+        *flags = openData.Flags;
+    }
+
+    int result = ERAR_SUCCESS;
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    while ((result = RARReadHeaderEx(arc, &header)) == ERAR_SUCCESS) {
+        entries.push_back(Entry());
+        entries.back().name = header.FileName;
+        RARSetCallback(arc, CopyDataCallback, (LPARAM)&entries.back().data);
+        int operation = openMode == RAR_OM_EXTRACT ? RAR_TEST : RAR_SKIP;
+        if ((result = RARProcessFile(arc, operation, NULL, NULL)) != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return result == ERAR_END_ARCHIVE ? ERAR_SUCCESS : result;
+}
+
+
+static void CompareEntries(const char *path, const std::vector<Entry> &expected, const std::vector<Entry> &entries,
+                           const char *mode)
+{
+    CHECK(entries.size() == expected.size(), "%s: %zu entries from memory in %s mode, %zu from file",
+          path, entries.size(), mode, expected.size());
+    for (size_t i = 0; i < entries.size() && i < expected.size(); i++) {
+        CHECK(entries[i].name == expected[i].name, "%s: entry %zu is %s from memory, %s from file",
+              path, i, entries[i].name.c_str(), expected[i].name.c_str());
+        CHECK(entries[i].data == expected[i].data, "%s: %s data from memory differs in %s mode",
+              path, entries[i].name.c_str(), mode);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        const char *path = argv[i];
+
+        Buffer arcData;
+        CHECK(ReadFile(path, arcData), "%s: cannot read", path);
+
+        std::vector<Entry> expected;
+        int code = ExtractAll(path, NULL, RAR_OM_EXTRACT, expected);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction from file returned %d", path, code);
+
+        std::vector<Entry> extracted;
+        code = ExtractAll(path, &arcData, RAR_OM_EXTRACT, extracted);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction from memory returned %d", path, code);
+        CompareEntries(path, expected, extracted, "extract");
+
+        std::vector<Entry> mapped;
+        code = ExtractAll(path, NULL, RAR_OM_EXTRACT, mapped, ROADOF_MMAP);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction from mapped file returned %d", path, code);
+        CompareEntries(path, expected, mapped, "mapped extract");
+
+        std::vector<Entry> listed;
+        code = ExtractAll(path, &arcData, RAR_OM_LIST, listed);
+        CHECK(code == ERAR_SUCCESS, "%s: listing from memory returned %d", path, code);
+        for (size_t e = 0; e < expected.size(); e++) {
+            expected[e].data.clear();
+        }
+        CompareEntries(path, expected, listed, "list");
+
+        std::vector<Entry> mappedList;
+        code = ExtractAll(path, NULL, RAR_OM_LIST, mappedList, ROADOF_MMAP);
+        CHECK(code == ERAR_SUCCESS, "%s: listing from mapped file returned %d", path, code);
+        CompareEntries(path, expected, mappedList, "mapped list");
+
+        // ArcName is optional for archives in memory, but next volumes cannot be found without it.
+        std::vector<Entry> unnamed;
+        unsigned int flags = 0;
+        code = ExtractAll(NULL, &arcData, RAR_OM_LIST, unnamed, 0, &flags);
+        if ((flags & ROADF_VOLUME) == 0) {
+            CHECK(code == ERAR_SUCCESS && unnamed.size() == listed.size(),
+                  "%s: listing from memory without name returned %d, %zu entries, %zu with name",
+                  path, code, unnamed.size(), listed.size());
+        } else {
+            // Listing fails when it needs the next volume, unless this is the last one.
+            CHECK((code == ERAR_EOPEN && unnamed.size() < listed.size()) ||
+                  (code == ERAR_SUCCESS && unnamed.size() == listed.size()),
+                  "%s: listing volume from memory without name returned %d, %zu entries, %zu with name",
+                  path, code, unnamed.size(), listed.size());
+        }
+
+        // Truncated archives must fail without reading past the block end.
+        for (size_t size = 1; size < arcData.size(); size += 1 + size / 3) {
+            Buffer truncated(arcData.begin(), arcData.begin() + size);
+            std::vector<Entry> partial;
+            code = ExtractAll(path, &truncated, RAR_OM_EXTRACT, partial);
+            CHECK(code != ERAR_SUCCESS || partial.size() < expected.size() || size >= arcData.size() - 64,
+                  "%s: archive truncated to %zu bytes extracted without errors", path, size);
+        }
+
+        PrintResult(path, expected.size(), previousFailures);
+    }
+    return TestResult();
+}
@@ -0,0 +1,361 @@
+//
+//  QuickOpenTests.cpp
+//  UnrarKit
+//
+//  Makes copies of RAR5 archives with quick open information containing
+//  all file headers, and checks files listed, extracted and found by number
+//  in all quick open modes against the original archive. In another copy
+//  file headers are damaged outside of quick open information, so they are
+//  read without errors only if it is used. A stored RAR5 archive is
+//  generated for this in addition to the given archives. Built and run on
+//  Linux by Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+static const unsigned int quickOpenModes[] = {RAR_QOPEN_AUTO, RAR_QOPEN_NONE, RAR_QOPEN_ALWAYS};
+
+
+static bool GetVInt(const Buffer &data, size_t &pos, unsigned long long &value)
+{
+    value = 0;
+    for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+        unsigned char byte = data[pos++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+struct Block {
+    size_t pos;
+    size_t headerSize; // Including CRC32 and size fields.
+    size_t dataSize;
+    unsigned long long type;
+    unsigned long long flags;
+    size_t fieldsPos;  // First field after header type and flags.
+};
+
+
+static bool ReadBlocks(const Buffer &archive, std::vector<Block> &blocks)
+{
+    size_t pos = sizeof(rar5Signature);
+    while (pos < archive.size()) {
+        Block block;
+        block.pos = pos;
+        size_t fieldPos = pos + 4;
+        unsigned long long headerSize, extraSize = 0, dataSize = 0;
+        if (!GetVInt(archive, fieldPos, headerSize)) {
+            return false;
+        }
+        size_t headerEnd = fieldPos + (size_t)headerSize;
+        if (!GetVInt(archive, fieldPos, block.type) || !GetVInt(archive, fieldPos, block.flags) ||
+            ((block.flags & 1) != 0 && !GetVInt(archive, fieldPos, extraSize)) ||
+            ((block.flags & 2) != 0 && !GetVInt(archive, fieldPos, dataSize))) {
+            return false;
+        }
+        block.fieldsPos = fieldPos;
+        block.headerSize = headerEnd - pos;
+        block.dataSize = (size_t)dataSize;
+        if (headerEnd + block.dataSize > archive.size()) {
+            return false;
+        }
+        blocks.push_back(block);
+        pos = headerEnd + block.dataSize;
+        if (block.type == 5) {
+            break;
+        }
+    }
+    return !blocks.empty() && blocks[0].type == 1 && blocks.back().type == 5;
+}
+
+
+// Main header with locator of quick open information at given offset.
+// Offset is written in fixed size, so header size does not depend on it.
+static Buffer MainHeaderWithLocator(unsigned long long archiveFlags, unsigned long long quickOpenOffset)
+{
+    Buffer locator;
+    PutVInt(locator, 1); // Locator record.
+    PutVInt(locator, 1); // Quick open offset is present.
+    for (int i = 0; i < 8; i++) {
+        locator.push_back(((quickOpenOffset >> (i * 7)) & 0x7f) | (i < 7 ? 0x80 : 0));
+    }
+    Buffer extra;
+    PutVInt(extra, locator.size());
+    extra.insert(extra.end(), locator.begin(), locator.end());
+
+    Buffer main;
+    PutVInt(main, 1);
+    PutVInt(main, 1); // Extra area is present.
+    PutVInt(main, extra.size());
+    PutVInt(main, archiveFlags);
+    main.insert(main.end(), extra.begin(), extra.end());
+
+    Buffer block;
+    PutBlock(block, main);
+    return block;
+}
+
+
+// Copies single volume RAR5 archive with unencrypted headers adding quick
+// open information with all file headers. If damageHeaders is true,
+// CRC32 of file headers outside of quick open information is damaged.
+static bool MakeQuickOpenCopy(const Buffer &archive, bool damageHeaders, Buffer &copy)
+{
+    std::vector<Block> blocks;
+    if (archive.size() < sizeof(rar5Signature) ||
+        memcmp(&archive[0], rar5Signature, sizeof(rar5Signature)) != 0 || !ReadBlocks(archive, blocks)) {
+        return false;
+    }
+    size_t fieldPos = blocks[0].fieldsPos;
+    unsigned long long archiveFlags;
+    if ((blocks[0].flags & 1) != 0 || !GetVInt(archive, fieldPos, archiveFlags) || (archiveFlags & 1) != 0) {
+        return false; // Has extra records already or is volume.
+    }
+
+    size_t mainSize = MainHeaderWithLocator(archiveFlags, 0).size();
+    copy.assign(rar5Signature, rar5Signature + sizeof(rar5Signature));
+    copy.resize(copy.size() + mainSize);
+
+    Buffer quickOpenData;
+    std::vector<size_t> filePositions;
+    for (size_t i = 1; i + 1 < blocks.size(); i++) {
+        const Block &block = blocks[i];
+        if (block.type == 4) {
+            return false; // Encrypted headers.
+        }
+        size_t pos = copy.size();
+        copy.insert(copy.end(), archive.begin() + block.pos,
+                    archive.begin() + block.pos + block.headerSize + block.dataSize);
+        if (block.type == 2) {
+            filePositions.push_back(pos);
+            if (damageHeaders) {
+                copy[pos] ^= 0xff;
+            }
+        }
+    }
+
+    // Cached header records refer to headers by offset from quick open
+    // service header, which follows the last file.
+    size_t quickOpenPos = copy.size();
+    for (size_t i = 0, file = 0; i + 1 < blocks.size(); i++) {
+        if (blocks[i].type != 2) {
+            continue;
+        }
+        Buffer record;
+        PutVInt(record, 0);
+        PutVInt(record, quickOpenPos - filePositions[file++]);
+        PutVInt(record, blocks[i].headerSize);
+        record.insert(record.end(), archive.begin() + blocks[i].pos,
+                      archive.begin() + blocks[i].pos + blocks[i].headerSize);
+        PutBlock(quickOpenData, record);
+    }
+
+    Buffer service;
+    PutVInt(service, 3);  // Service header.
+    PutVInt(service, 2);  // Data area is present.
+    PutVInt(service, quickOpenData.size());
+    PutVInt(service, 0);  // No time and CRC32.
+    PutVInt(service, quickOpenData.size());
+    PutVInt(service, 0);
+    PutVInt(service, 0);  // Stored.
+    PutVInt(service, 1);
+    PutVInt(service, 2);
+    service.push_back('Q');
+    service.push_back('O');
+    PutBlock(copy, service);
+    copy.insert(copy.end(), quickOpenData.begin(), quickOpenData.end());
+
+    const Block &end = blocks.back();
+    copy.insert(copy.end(), archive.begin() + end.pos, archive.begin() + end.pos + end.headerSize);
+
+    Buffer main = MainHeaderWithLocator(archiveFlags, quickOpenPos - sizeof(rar5Signature));
+    memcpy(&copy[sizeof(rar5Signature)], &main[0], main.size());
+    return true;
+}
+
+
+struct Entry {
+    Header header;
+    Buffer data;
+};
+
+
+static bool operator==(const Entry &a, const Entry &b)
+{
+    return a.header == b.header && a.data == b.data;
+}
+
+
+// Archive name is not compared, because copies are compared to the original.
+static Entry MakeEntry(const RARHeaderDataEx &header)
+{
+    Entry entry;
+    entry.header = MakeHeader(header);
+    entry.header.arcName.clear();
+    return entry;
+}
+
+
+static HANDLE Open(const char *path, unsigned int openMode, unsigned int quickOpenMode)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, openMode);
+    openData.QOpenMode = quickOpenMode;
+    return RAROpenArchiveEx(&openData);
+}
+
+
+// Reads headers of all files. In RAR_OM_EXTRACT mode also tests files
+// and stores their data.
+static int ReadEntries(const char *path, unsigned int openMode, unsigned int quickOpenMode,
+                       std::vector<Entry> &entries)
+{
+    HANDLE arc = Open(path, openMode, quickOpenMode);
+    if (arc == NULL) {
+        return ERAR_EOPEN;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    int code;
+    while ((code = RARReadHeaderEx(arc, &header)) == ERAR_SUCCESS) {
+        entries.push_back(MakeEntry(header));
+        if (openMode == RAR_OM_EXTRACT) {
+            RARSetCallback(arc, CopyDataCallback, (LPARAM)&entries.back().data);
+            code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        } else {
+            code = RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+        }
+        if (code != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return code;
+}
+
+
+// Finds files by number in reverse order and tests them.
+static void CheckLookups(const char *path, unsigned int quickOpenMode, const std::vector<Entry> &expected)
+{
+    HANDLE arc = Open(path, RAR_OM_EXTRACT, quickOpenMode);
+    CHECK(arc != NULL, "%s: cannot open in quick open mode %u", path, quickOpenMode);
+    if (arc == NULL) {
+        return;
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    for (size_t i = expected.size(); i-- > 0;) {
+        int code = RARReadHeaderByIndex(arc, (unsigned int)i, &header);
+        Entry entry = MakeEntry(header);
+        if (code == ERAR_SUCCESS) {
+            RARSetCallback(arc, CopyDataCallback, (LPARAM)&entry.data);
+            code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        }
+        CHECK(code == ERAR_SUCCESS && entry == expected[i], "%s: lookup of %s returned %d in quick open mode %u",
+              path, expected[i].header.fileName.c_str(), code, quickOpenMode);
+    }
+    RARCloseArchive(arc);
+}
+
+
+static void CheckQuickOpenCopy(const char *path, const std::string &copyPath,
+                               const std::vector<Entry> &headers, const std::vector<Entry> &files)
+{
+    for (size_t i = 0; i < sizeof(quickOpenModes) / sizeof(quickOpenModes[0]); i++) {
+        unsigned int mode = quickOpenModes[i];
+        std::vector<Entry> copyHeaders, copyFiles;
+        int code = ReadEntries(copyPath.c_str(), RAR_OM_LIST_INCSPLIT, mode, copyHeaders);
+        CHECK(code == ERAR_END_ARCHIVE && copyHeaders == headers,
+              "%s: listing copy with quick open information returned %d in mode %u", path, code, mode);
+        code = ReadEntries(copyPath.c_str(), RAR_OM_EXTRACT, mode, copyFiles);
+        CHECK(code == ERAR_END_ARCHIVE && copyFiles == files,
+              "%s: testing copy with quick open information returned %d in mode %u", path, code, mode);
+        CheckLookups(copyPath.c_str(), mode, files);
+    }
+}
+
+
+// Damaged headers are read only if quick open information is ignored.
+static void CheckDamagedCopy(const char *path, const std::string &copyPath, const std::vector<Entry> &headers)
+{
+    std::vector<Entry> quickOpenHeaders, archiveHeaders;
+    int code = ReadEntries(copyPath.c_str(), RAR_OM_LIST_INCSPLIT, RAR_QOPEN_AUTO, quickOpenHeaders);
+    CHECK(code == ERAR_END_ARCHIVE && quickOpenHeaders == headers,
+          "%s: listing copy with damaged headers returned %d", path, code);
+    code = ReadEntries(copyPath.c_str(), RAR_OM_LIST_INCSPLIT, RAR_QOPEN_NONE, archiveHeaders);
+    CHECK(code == ERAR_BAD_DATA, "%s: damaged headers not detected without quick open information", path);
+
+    HANDLE arc = Open(copyPath.c_str(), RAR_OM_LIST, RAR_QOPEN_AUTO);
+    RARList *list = NULL;
+    code = arc != NULL ? RARListAll(arc, &list) : ERAR_EOPEN;
+    CHECK(code == ERAR_SUCCESS && list != NULL, "%s: RARListAll of copy with damaged headers returned %d",
+          path, code);
+    RARFreeList(list);
+    if (arc != NULL) {
+        RARCloseArchive(arc);
+    }
+}
+
+
+static void CheckArchive(const char *path, const std::string &directory)
+{
+    int previousFailures = failures;
+    std::vector<Entry> headers, files;
+    if (ReadEntries(path, RAR_OM_LIST_INCSPLIT, RAR_QOPEN_NONE, headers) != ERAR_END_ARCHIVE ||
+        ReadEntries(path, RAR_OM_EXTRACT, RAR_QOPEN_NONE, files) != ERAR_END_ARCHIVE) {
+        CHECK(false, "%s: cannot read", path);
+        return;
+    }
+
+    // Archives without quick open information are read same in all modes.
+    for (size_t i = 0; i < sizeof(quickOpenModes) / sizeof(quickOpenModes[0]); i++) {
+        std::vector<Entry> modeHeaders;
+        CHECK(ReadEntries(path, RAR_OM_LIST_INCSPLIT, quickOpenModes[i], modeHeaders) == ERAR_END_ARCHIVE &&
+              modeHeaders == headers, "%s: listing differs in quick open mode %u", path, quickOpenModes[i]);
+    }
+
+    Buffer archive, copy;
+    const char *result = "OK";
+    std::string copyPath = directory + "/copy.rar";
+    if (!ReadFile(path, archive) || !MakeQuickOpenCopy(archive, false, copy)) {
+        result = "OK, no RAR5 copy";
+    } else {
+        CHECK(WriteFile(copyPath.c_str(), copy), "%s: cannot write copy", path);
+        CheckQuickOpenCopy(path, copyPath, headers, files);
+        CHECK(MakeQuickOpenCopy(archive, true, copy) && WriteFile(copyPath.c_str(), copy),
+              "%s: cannot write damaged copy", path);
+        CheckDamagedCopy(path, copyPath, headers);
+        unlink(copyPath.c_str());
+    }
+    PrintResult(path, headers.size(), previousFailures, result);
+}
+
+
+int main(int argc, char *argv[])
+{
+    char directory[] = "/tmp/unrar-qopen-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    std::string generatedPath = std::string(directory) + "/generated.rar";
+    if (!WriteFile(generatedPath.c_str(), MakeStoredArchive(MakeRandomFiles(300, 20000)))) {
+        perror(generatedPath.c_str());
+        return 2;
+    }
+    CheckArchive(generatedPath.c_str(), directory);
+    unlink(generatedPath.c_str());
+
+    for (int i = 1; i < argc; i++) {
+        CheckArchive(argv[i], directory);
+    }
+    rmdir(directory);
+    return TestResult();
+}
@@ -0,0 +1,341 @@
+//
+//  ReadAtTests.cpp
+//  UnrarKit
+//
+//  Checks byte ranges of stored files read with RARReadAt against data
+//  returned through the UCM_PROCESSDATA callback, and that compressed
+//  files are rejected. Stored RAR5 archives are generated for encrypted
+//  files and files split between volumes, in addition to the given
+//  archives. Split archives are also read through stream callbacks and
+//  from memory, where files continued in next volumes are not readable.
+//  Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include <algorithm>
+
+#include "TestInternals.h"
+
+static const char *password = "password";
+
+
+// Writes files to name.rar, or if volumeSize is not 0, to name.part1.rar
+// and next volumes with so many bytes of packed data. Part boundaries are
+// not aligned to AES blocks. Returns names of written volumes.
+static std::vector<std::string> WriteArchive(const std::string &name, const std::vector<StoredFile> &files,
+                                             size_t volumeSize, bool encrypt)
+{
+    std::vector<Buffer> volumes(1);
+    PutMainHeader(volumes[0], volumeSize != 0);
+    size_t volumeData = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        Buffer packed = files[i].data, extra;
+        if (encrypt) {
+            unsigned char salt[SIZE_SALT50], initVector[SIZE_INITV];
+            for (size_t j = 0; j < sizeof(salt); j++) {
+                salt[j] = (unsigned char)rand();
+                initVector[j] = (unsigned char)rand();
+            }
+            EncryptData(password, salt, initVector, packed);
+            PutExtraRecord(extra, FHEXTRA_CRYPT, CryptRecordFields(salt, initVector));
+        }
+
+        size_t pos = 0;
+        do {
+            if (volumeSize != 0 && volumeData == volumeSize) {
+                PutEndHeader(volumes.back(), true);
+                volumes.push_back(Buffer());
+                PutMainHeader(volumes.back(), true, (unsigned int)volumes.size() - 1);
+                volumeData = 0;
+            }
+            size_t partSize = volumeSize == 0 ? packed.size() : std::min(packed.size() - pos, volumeSize - volumeData);
+            Buffer part(packed.begin() + pos, packed.begin() + pos + partSize);
+
+            StoredHeader header(files[i].name, files[i].data);
+            header.packSize = partSize;
+            header.mtime = files[i].mtime;
+            header.extra = extra;
+            header.splitFlags = (pos > 0 ? 0x08 : 0) | (pos + partSize < packed.size() ? 0x10 : 0);
+            if ((header.splitFlags & 0x10) != 0) {
+                header.crc = Crc32(part);
+            }
+            PutFileHeader(volumes.back(), header);
+            volumes.back().insert(volumes.back().end(), part.begin(), part.end());
+            pos += partSize;
+            volumeData += partSize;
+        } while (pos < packed.size());
+    }
+    PutEndHeader(volumes.back());
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < volumes.size(); i++) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), volumeSize != 0 ? ".part%zu.rar" : ".rar", i + 1);
+        names.push_back(name + suffix);
+        CHECK(WriteFile(names.back().c_str(), volumes[i]), "%s: cannot write", names.back().c_str());
+    }
+    return names;
+}
+
+
+// Files with sizes around AES block size and larger than volumes.
+static std::vector<StoredFile> MakeFiles()
+{
+    static const size_t sizes[] = {0, 1, 15, 16, 17, 40000, 100003, 5000};
+    std::vector<StoredFile> files = MakeRandomFiles(sizeof(sizes) / sizeof(sizes[0]), 1);
+    for (size_t i = 0; i < files.size(); i++) {
+        files[i].data.resize(sizes[i]);
+        for (size_t j = 0; j < sizes[i]; j++) {
+            files[i].data[j] = (unsigned char)rand();
+        }
+    }
+    return files;
+}
+
+
+// Volumes in memory read through stream callbacks.
+struct VolumeStream {
+    std::vector<std::string> names;
+    std::vector<Buffer> volumes;
+    size_t volume;
+    size_t pos;
+};
+
+
+static int CALLBACK StreamRead(LPARAM UserData, void *Buf, unsigned int Size)
+{
+    VolumeStream *stream = (VolumeStream *)UserData;
+    const Buffer &data = stream->volumes[stream->volume];
+    size_t readSize = stream->pos < data.size() ? std::min((size_t)Size, data.size() - stream->pos) : 0;
+    memcpy(Buf, data.data() + stream->pos, readSize);
+    stream->pos += readSize;
+    return (int)readSize;
+}
+
+
+static int CALLBACK StreamSeek(LPARAM UserData, long long Pos)
+{
+    ((VolumeStream *)UserData)->pos = (size_t)Pos;
+    return 0;
+}
+
+
+static long long CALLBACK StreamSize(LPARAM UserData)
+{
+    VolumeStream *stream = (VolumeStream *)UserData;
+    return stream->volumes[stream->volume].size();
+}
+
+
+static int CALLBACK StreamOpenVolume(LPARAM UserData, const wchar_t *VolName)
+{
+    VolumeStream *stream = (VolumeStream *)UserData;
+    char name[4096];
+    if (wcstombs(name, VolName, sizeof(name)) == (size_t)-1) {
+        return -1;
+    }
+    for (size_t i = 0; i < stream->names.size(); i++) {
+        if (stream->names[i] == name) {
+            stream->volume = i;
+            stream->pos = 0;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+static void CheckRange(HANDLE arc, const char *path, const RARHeaderDataEx &header, const Buffer &expected,
+                       unsigned long long offset, unsigned int size)
+{
+    Buffer data(size + 1);
+    unsigned int readSize = 0;
+    int code = RARReadAt(arc, offset, data.data(), size, &readSize);
+    CHECK(code == ERAR_SUCCESS, "%s: reading %s at %llu returned %d", path, header.FileName, offset, code);
+
+    size_t expectedSize = offset < expected.size() ? std::min((size_t)size, expected.size() - (size_t)offset) : 0;
+    CHECK(readSize == expectedSize && memcmp(data.data(), expected.data() + std::min((size_t)offset, expected.size()), readSize) == 0,
+          "%s: %u bytes of %s at %llu differ from callback data", path, size, header.FileName, offset);
+}
+
+
+// Reads several ranges of every stored file, including ones crossing
+// and following the end of file, with the given open data. Overlapping
+// ranges through the entire file cross all AES block and volume boundaries.
+// Files continued after volume in caller memory or stream cannot be read.
+static void ReadStoredFiles(const char *path, const std::vector<Buffer> &expected, RAROpenArchiveDataEx &openData,
+                            const char *password = NULL)
+{
+    bool callerInput = openData.ArcData != NULL || openData.ArcStream != NULL;
+    VolumeStream *stream = openData.ArcStream != NULL ? (VolumeStream *)openData.ArcStream->UserData : NULL;
+    HANDLE arc = RAROpenArchiveEx(&openData);
+    CHECK(arc != NULL, "%s: cannot open", path);
+    if (arc == NULL) {
+        return;
+    }
+    if (password != NULL) {
+        RARSetPassword(arc, (char *)password);
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    size_t entry = 0;
+    bool firstVolume = true;
+    while (RARReadHeaderEx(arc, &header) == ERAR_SUCCESS) {
+        // Skipping split file in extraction mode returns its headers
+        // in next volumes too. File data cannot be read from them.
+        if ((header.Flags & RHDF_SPLITBEFORE) != 0) {
+            unsigned char byte;
+            unsigned int readSize = 0;
+            int code = RARReadAt(arc, 0, &byte, 1, &readSize);
+            CHECK(code == (header.Method == 0x30 ? ERAR_EOPEN : ERAR_UNKNOWN_FORMAT),
+                  "%s: reading continued %s returned %d", path, header.FileName, code);
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+            continue;
+        }
+        if (entry == expected.size()) {
+            entry++;
+            break;
+        }
+
+        const Buffer &data = expected[entry++];
+        if ((header.Flags & RHDF_DIRECTORY) != 0) {
+            RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+            continue;
+        }
+
+        // Memory block holds only the first volume, next ones are files.
+        // Headers following a split file are in next volumes.
+        bool callerVolume = callerInput && (stream != NULL || firstVolume);
+        if ((header.Flags & RHDF_SPLITAFTER) != 0) {
+            firstVolume = false;
+        }
+        if (header.Method != 0x30) {
+            unsigned char byte;
+            unsigned int readSize = 0;
+            int code = RARReadAt(arc, 0, &byte, 1, &readSize);
+            CHECK(code == ERAR_UNKNOWN_FORMAT, "%s: reading compressed %s returned %d", path, header.FileName, code);
+        } else if ((header.Flags & RHDF_SPLITAFTER) != 0 && callerVolume) {
+            unsigned char byte;
+            unsigned int readSize = 0;
+            size_t volume = stream != NULL ? stream->volume : 0;
+            int code = RARReadAt(arc, 0, &byte, 1, &readSize);
+            CHECK(code == ERAR_EOPEN && readSize == 0, "%s: reading split %s from caller input returned %d", path,
+                  header.FileName, code);
+            CHECK(stream == NULL || stream->volume == volume, "%s: reading split %s switched stream volume", path,
+                  header.FileName);
+        } else {
+            unsigned long long size = data.size();
+            CheckRange(arc, path, header, data, size / 3, 100);
+            CheckRange(arc, path, header, data, 0, (unsigned int)size);
+            CheckRange(arc, path, header, data, 1, 17);
+            CheckRange(arc, path, header, data, size > 10 ? size - 10 : 0, 100);
+            CheckRange(arc, path, header, data, size, 1);
+            CheckRange(arc, path, header, data, 15, 2);
+            CheckRange(arc, path, header, data, 16, 16);
+            CheckRange(arc, path, header, data, 17, 31);
+            for (unsigned long long offset = 0; offset < size; offset += 4093) {
+                CheckRange(arc, path, header, data, offset, 4093 + 33);
+            }
+        }
+        RARProcessFile(arc, RAR_SKIP, NULL, NULL);
+    }
+    CHECK(entry == expected.size(), "%s: %zu entries, %zu with callback", path, entry, expected.size());
+    RARCloseArchive(arc);
+}
+
+
+static void CheckArchive(const char *path, const char *password = NULL)
+{
+    int previousFailures = failures;
+    std::vector<Buffer> expected;
+    if (!ExtractWithCallback(path, expected, password)) {
+        CHECK(false, "%s: cannot open", path);
+        return;
+    }
+
+    unsigned int openModes[] = {RAR_OM_EXTRACT, RAR_OM_LIST};
+    for (size_t i = 0; i < sizeof(openModes) / sizeof(openModes[0]); i++) {
+        RAROpenArchiveDataEx openData;
+        InitOpenData(openData, path, openModes[i]);
+        ReadStoredFiles(path, expected, openData, password);
+    }
+    PrintResult(path, expected.size(), previousFailures);
+}
+
+
+// Reads the split archive through stream callbacks, which open next
+// volumes, and with the first volume in memory.
+static void CheckCallerInput(const std::vector<std::string> &names)
+{
+    const char *path = names[0].c_str();
+    int previousFailures = failures;
+    std::vector<Buffer> expected;
+    if (!ExtractWithCallback(path, expected)) {
+        CHECK(false, "%s: cannot open", path);
+        return;
+    }
+
+    VolumeStream stream;
+    stream.names = names;
+    stream.volumes.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        CHECK(ReadFile(names[i].c_str(), stream.volumes[i]), "%s: cannot read", names[i].c_str());
+    }
+    RARArchiveStream arcStream;
+    memset(&arcStream, 0, sizeof(arcStream));
+    arcStream.UserData = (LPARAM)&stream;
+    arcStream.Read = StreamRead;
+    arcStream.Seek = StreamSeek;
+    arcStream.Size = StreamSize;
+    arcStream.OpenVolume = StreamOpenVolume;
+
+    unsigned int openModes[] = {RAR_OM_EXTRACT, RAR_OM_LIST};
+    for (size_t i = 0; i < sizeof(openModes) / sizeof(openModes[0]); i++) {
+        RAROpenArchiveDataEx openData;
+        InitOpenData(openData, path, openModes[i]);
+        stream.volume = 0;
+        stream.pos = 0;
+        openData.ArcStream = &arcStream;
+        ReadStoredFiles(path, expected, openData);
+
+        InitOpenData(openData, path, openModes[i]);
+        openData.ArcData = stream.volumes[0].data();
+        openData.ArcDataSize = stream.volumes[0].size();
+        ReadStoredFiles(path, expected, openData);
+    }
+    PrintResult(path, expected.size(), previousFailures, "OK from caller input");
+}
+
+
+int main(int argc, char *argv[])
+{
+    char directory[] = "/tmp/unrar-readat-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    std::vector<StoredFile> files = MakeFiles();
+    std::string name = std::string(directory) + "/";
+    std::vector<std::string> encrypted = WriteArchive(name + "encrypted", files, 0, true);
+    std::vector<std::string> split = WriteArchive(name + "split", files, 30011, false);
+    std::vector<std::string> encryptedSplit = WriteArchive(name + "encrypted-split", files, 30011, true);
+
+    CheckArchive(encrypted[0].c_str(), password);
+    CheckArchive(split[0].c_str());
+    CheckArchive(encryptedSplit[0].c_str(), password);
+    CheckCallerInput(split);
+    CHECK(split.size() > 2 && encryptedSplit.size() > 2, "generated archives have too few volumes");
+
+    split.insert(split.end(), encrypted.begin(), encrypted.end());
+    split.insert(split.end(), encryptedSplit.begin(), encryptedSplit.end());
+    for (size_t i = 0; i < split.size(); i++) {
+        unlink(split[i].c_str());
+    }
+    rmdir(directory);
+
+    for (int i = 1; i < argc; i++) {
+        CheckArchive(argv[i]);
+    }
+    return TestResult();
+}
@@ -0,0 +1,182 @@
+//
+//  StreamInputTests.cpp
+//  UnrarKit
+//
+//  Checks archives read through RARArchiveStream callbacks against the
+//  same archives opened from files. Also checks listing, which reads
+//  headers through the read-ahead buffer. Built and run on Linux by
+//  Scripts/test-linux.sh
+//
+
+#include "TestSupport.h"
+
+struct Entry {
+    std::string name;
+    Buffer data;
+};
+
+// Stream over a file, which reads at most maxRead bytes per call.
+struct FileStream {
+    FILE *file;
+    size_t maxRead;
+    int seekCount;
+    int volumeCount;
+};
+
+
+static int CALLBACK StreamRead(LPARAM UserData, void *Buf, unsigned int Size)
+{
+    FileStream *stream = (FileStream *)UserData;
+    size_t readSize = fread(Buf, 1, Size < stream->maxRead ? Size : stream->maxRead, stream->file);
+    return ferror(stream->file) ? -1 : (int)readSize;
+}
+
+
+static int CALLBACK StreamSeek(LPARAM UserData, long long Pos)
+{
+    FileStream *stream = (FileStream *)UserData;
+    stream->seekCount++;
+    return fseeko(stream->file, (off_t)Pos, SEEK_SET);
+}
+
+
+static long long CALLBACK StreamSize(LPARAM UserData)
+{
+    FileStream *stream = (FileStream *)UserData;
+    off_t pos = ftello(stream->file);
+    fseeko(stream->file, 0, SEEK_END);
+    off_t size = ftello(stream->file);
+    fseeko(stream->file, pos, SEEK_SET);
+    return size;
+}
+
+
+static int CALLBACK StreamOpenVolume(LPARAM UserData, const wchar_t *VolName)
+{
+    FileStream *stream = (FileStream *)UserData;
+    char name[4096];
+    if (wcstombs(name, VolName, sizeof(name)) == (size_t)-1) {
+        return -1;
+    }
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    fclose(stream->file);
+    stream->file = file;
+    stream->volumeCount++;
+    return 0;
+}
+
+
+// Opens the archive from the path, or through arcStream if it isn't NULL,
+// and unpacks all entries. Returns the RAROpenArchiveEx or the first error code.
+static int ExtractAll(const char *path, RARArchiveStream *arcStream, std::vector<Entry> &entries,
+                      unsigned int *flags = NULL, unsigned int openMode = RAR_OM_EXTRACT)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, openMode);
+    openData.ArcStream = arcStream;
+
+    HANDLE arc = RAROpenArchiveEx(&openData);
+    if (arc == NULL) {
+        return openData.OpenResult;
+    }
+    if (flags != NULL) {
+        *flags = openData.Flags;
+    }
+
+    int result = ERAR_SUCCESS;
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    while ((result = RARReadHeaderEx(arc, &header)) == ERAR_SUCCESS) {
+        entries.push_back(Entry());
+        entries.back().name = header.FileName;
+        RARSetCallback(arc, CopyDataCallback, (LPARAM)&entries.back().data);
+        int operation = openMode == RAR_OM_EXTRACT ? RAR_TEST : RAR_SKIP;
+        if ((result = RARProcessFile(arc, operation, NULL, NULL)) != ERAR_SUCCESS) {
+            break;
+        }
+    }
+    RARCloseArchive(arc);
+    return result == ERAR_END_ARCHIVE ? ERAR_SUCCESS : result;
+}
+
+
+static void ExtractFromStream(const char *path, const std::vector<Entry> &expected, size_t maxRead, bool openVolumes,
+                              unsigned int openMode = RAR_OM_EXTRACT)
+{
+    FileStream fileStream;
+    fileStream.file = fopen(path, "rb");
+    fileStream.maxRead = maxRead;
+    fileStream.seekCount = 0;
+    fileStream.volumeCount = 0;
+    CHECK(fileStream.file != NULL, "%s: cannot open", path);
+    if (fileStream.file == NULL) {
+        return;
+    }
+
+    RARArchiveStream arcStream;
+    memset(&arcStream, 0, sizeof(arcStream));
+    arcStream.UserData = (LPARAM)&fileStream;
+    arcStream.Read = StreamRead;
+    arcStream.Seek = StreamSeek;
+    arcStream.Size = StreamSize;
+    arcStream.OpenVolume = openVolumes ? StreamOpenVolume : NULL;
+
+    std::vector<Entry> entries;
+    unsigned int flags = 0;
+    int code = ExtractAll(path, &arcStream, entries, &flags, openMode);
+    fclose(fileStream.file);
+
+    CHECK(code == ERAR_SUCCESS, "%s: extraction from stream returned %d (read size %zu)", path, code, maxRead);
+    CHECK(entries.size() == expected.size(), "%s: %zu entries from stream, %zu from file",
+          path, entries.size(), expected.size());
+    for (size_t i = 0; i < entries.size() && i < expected.size(); i++) {
+        CHECK(entries[i].name == expected[i].name && entries[i].data == expected[i].data,
+              "%s: %s from stream differs from file (read size %zu)", path, entries[i].name.c_str(), maxRead);
+    }
+    CHECK(fileStream.seekCount > 0, "%s: stream was never positioned", path);
+    CHECK(!openVolumes || (flags & ROADF_VOLUME) == 0 || fileStream.volumeCount > 0,
+          "%s: next volumes were not opened through stream", path);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s archive.rar ...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        int previousFailures = failures;
+        const char *path = argv[i];
+
+        std::vector<Entry> expected;
+        int code = ExtractAll(path, NULL, expected);
+        CHECK(code == ERAR_SUCCESS, "%s: extraction from file returned %d", path, code);
+
+        ExtractFromStream(path, expected, 0x100000, true);
+        ExtractFromStream(path, expected, 0x100000, false);
+        ExtractFromStream(path, expected, 1000, true);
+        ExtractFromStream(path, expected, 1, true);
+
+        std::vector<Entry> listed;
+        code = ExtractAll(path, NULL, listed, NULL, RAR_OM_LIST);
+        CHECK(code == ERAR_SUCCESS, "%s: listing from file returned %d", path, code);
+        CHECK(listed.size() == expected.size(), "%s: %zu entries listed, %zu extracted", path, listed.size(), expected.size());
+        for (size_t e = 0; e < listed.size() && e < expected.size(); e++) {
+            CHECK(listed[e].name == expected[e].name, "%s: entry %zu is %s in listing, %s in extraction",
+                  path, e, listed[e].name.c_str(), expected[e].name.c_str());
+        }
+        for (size_t e = 0; e < listed.size(); e++) {
+            listed[e].data.clear();
+        }
+        ExtractFromStream(path, listed, 0x100000, true, RAR_OM_LIST);
+        ExtractFromStream(path, listed, 1000, true, RAR_OM_LIST);
+
+        PrintResult(path, expected.size(), previousFailures);
+    }
+    return TestResult();
+}
@@ -0,0 +1,66 @@
+//
+//  TestInternals.h
+//  UnrarKit
+//
+//  Encryption and BLAKE2 hashes for RAR5 archives written by the tests,
+//  made with UnRAR library classes. rar.hpp is included with the defines
+//  of the library makefile, which change the layout of some classes.
+//
+
+#ifndef UnrarKit_TestInternals_h
+#define UnrarKit_TestInternals_h
+
+#undef _UNIX // Defined again by raros.hpp.
+#define RARDLL
+#define RAR_SMP
+#include "rar.hpp"
+
+#include "TestSupport.h"
+
+
+// Fields of FHEXTRA_CRYPT record for AES-256 without password check.
+static inline Buffer CryptRecordFields(const unsigned char *salt, const unsigned char *initVector)
+{
+    Buffer fields;
+    PutVInt(fields, 0); // AES-256.
+    PutVInt(fields, 0); // No password check and MAC.
+    fields.push_back(CRYPT5_KDF_LG2_COUNT);
+    fields.insert(fields.end(), salt, salt + SIZE_SALT50);
+    fields.insert(fields.end(), initVector, initVector + SIZE_INITV);
+    return fields;
+}
+
+
+// Pads data with zeros to the AES block size and encrypts it with the key
+// RAR5 derives from password and salt.
+static inline void EncryptData(const char *password, const unsigned char *salt, const unsigned char *initVector,
+                               Buffer &data)
+{
+    byte key[32], hashKey[SHA256_DIGEST_SIZE], pswCheck[SHA256_DIGEST_SIZE];
+    pbkdf2((const byte *)password, strlen(password), salt, SIZE_SALT50, key, hashKey, pswCheck,
+           1 << CRYPT5_KDF_LG2_COUNT);
+    data.resize((data.size() + CRYPT_BLOCK_MASK) & ~(size_t)CRYPT_BLOCK_MASK);
+    if (!data.empty()) {
+        Rijndael aes;
+        aes.Init(true, key, 256, initVector);
+        aes.blockEncrypt(&data[0], data.size(), &data[0]);
+    }
+}
+
+
+// Fields of FHEXTRA_HASH record with BLAKE2sp hash of data.
+static inline Buffer HashRecordFields(const Buffer &data)
+{
+    DataHash hash;
+    hash.Init(HASH_BLAKE2, 1);
+    hash.Update(data.empty() ? NULL : &data[0], data.size());
+    HashValue value;
+    hash.Result(&value);
+
+    Buffer fields;
+    PutVInt(fields, FHEXTRA_HASH_BLAKE2);
+    fields.insert(fields.end(), value.Digest, value.Digest + BLAKE2_DIGEST_SIZE);
+    return fields;
+}
+
+#endif
@@ -0,0 +1,452 @@
+//
+//  TestSupport.h
+//  UnrarKit
+//
+//  Helpers shared by the UnRAR library tests in Tests/Linux: failure
+//  counting, opening archives, comparing headers, collecting data through
+//  the callback, file access and writing of RAR5 archives with stored
+//  files. Every test is a single source file including it.
+//
+
+#ifndef UnrarKit_TestSupport_h
+#define UnrarKit_TestSupport_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include "dll.hpp"
+
+typedef std::vector<unsigned char> Buffer;
+
+static int failures = 0;
+
+#define CHECK(condition, ...) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "FAILED: %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+
+// Prints the result line of one archive.
+static inline void PrintResult(const char *path, size_t entryCount, int previousFailures, const char *result = "OK")
+{
+    printf("%s: %zu entries %s\n", path, entryCount, failures == previousFailures ? result : "FAILED");
+}
+
+
+// Exit code of test program.
+static inline int TestResult()
+{
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
+
+
+// Appends unpacked data to Buffer passed as UserData, if it is not 0.
+static inline int CALLBACK CopyDataCallback(UINT msg, LPARAM UserData, LPARAM P1, LPARAM P2)
+{
+    if (msg == UCM_PROCESSDATA && UserData != 0) {
+        Buffer *data = (Buffer *)UserData;
+        data->insert(data->end(), (unsigned char *)P1, (unsigned char *)P1 + P2);
+    }
+    // Stop instead of retrying, if the next volume is missing.
+    if ((msg == UCM_CHANGEVOLUME || msg == UCM_CHANGEVOLUMEW) && P2 == RAR_VOL_ASK) {
+        return -1;
+    }
+    return 0;
+}
+
+
+static inline void InitOpenData(RAROpenArchiveDataEx &openData, const char *path, unsigned int openMode,
+                         unsigned int opFlags = 0)
+{
+    memset(&openData, 0, sizeof(openData));
+    openData.ArcName = (char *)path;
+    openData.OpenMode = openMode;
+    openData.OpFlags = opFlags;
+}
+
+
+static inline HANDLE OpenArchive(const char *path, unsigned int openMode, unsigned int opFlags = 0)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, openMode, opFlags);
+    return RAROpenArchiveEx(&openData);
+}
+
+
+// Opens archive with header index file, if indexName is not NULL.
+static inline HANDLE OpenWithIndex(const char *path, unsigned int openMode, const wchar_t *indexName,
+                                   unsigned int opFlags = 0)
+{
+    RAROpenArchiveDataEx openData;
+    InitOpenData(openData, path, openMode, opFlags);
+    openData.IndexNameW = (wchar_t *)indexName;
+    return RAROpenArchiveEx(&openData);
+}
+
+
+static inline std::string Utf8(const wchar_t *name)
+{
+    std::string utf8;
+    for (; *name != 0; name++) {
+        unsigned int c = (unsigned int)*name;
+        if (c < 0x80) {
+            utf8 += (char)c;
+        } else if (c < 0x800) {
+            utf8 += (char)(0xc0 | (c >> 6));
+            utf8 += (char)(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            utf8 += (char)(0xe0 | (c >> 12));
+            utf8 += (char)(0x80 | ((c >> 6) & 0x3f));
+            utf8 += (char)(0x80 | (c & 0x3f));
+        } else {
+            utf8 += (char)(0xf0 | (c >> 18));
+            utf8 += (char)(0x80 | ((c >> 12) & 0x3f));
+            utf8 += (char)(0x80 | ((c >> 6) & 0x3f));
+            utf8 += (char)(0x80 | (c & 0x3f));
+        }
+    }
+    return utf8;
+}
+
+
+// Indexes of header fields, which ROADOF_LAZYEXTRA can leave 0. FileCRC
+// holds the start of BLAKE2 hash, if it is used instead of CRC32.
+enum {
+    LAZY_FILETIME, LAZY_MTIME, LAZY_CTIME, LAZY_ATIME, LAZY_FILECRC, LAZY_HASHTYPE, LAZY_REDIRTYPE, LAZY_DIRTARGET,
+    LAZY_FIELD_COUNT
+};
+
+// File header returned by RARReadHeaderEx or RARListAll, comparable
+// between both. Names are UTF-8, hash is 0 if it is not BLAKE2.
+struct Header {
+    std::string arcName;
+    std::string fileName;
+    std::string fileNameA;  // Not returned by RARListAll.
+    std::string redirName;
+    unsigned long long fields[9];
+    unsigned long long lazyFields[LAZY_FIELD_COUNT];
+    unsigned char hash[32];
+    bool listed;
+};
+
+
+// Link target is read if RedirName buffer is set in data.
+static inline Header MakeHeader(const RARHeaderDataEx &data)
+{
+    Header header;
+    header.arcName = Utf8(data.ArcNameW);
+    header.fileName = Utf8(data.FileNameW);
+    header.fileNameA = data.FileName;
+    header.redirName = data.RedirType != 0 && data.RedirName != NULL ? Utf8(data.RedirName) : "";
+    unsigned long long fields[] = {
+        data.Flags, (unsigned long long)data.PackSizeHigh << 32 | data.PackSize,
+        (unsigned long long)data.UnpSizeHigh << 32 | data.UnpSize, data.HostOS, data.UnpVer, data.Method,
+        data.FileAttr, data.DictSize, data.CmtState
+    };
+    unsigned long long lazyFields[] = {
+        data.FileTime, (unsigned long long)data.MtimeHigh << 32 | data.MtimeLow,
+        (unsigned long long)data.CtimeHigh << 32 | data.CtimeLow,
+        (unsigned long long)data.AtimeHigh << 32 | data.AtimeLow, data.FileCRC, data.HashType, data.RedirType,
+        data.DirTarget != 0
+    };
+    memcpy(header.fields, fields, sizeof(header.fields));
+    memcpy(header.lazyFields, lazyFields, sizeof(header.lazyFields));
+    memset(header.hash, 0, sizeof(header.hash));
+    if (data.HashType == RAR_HASH_BLAKE2) {
+        memcpy(header.hash, data.Hash, sizeof(header.hash));
+    }
+    header.listed = false;
+    return header;
+}
+
+
+// Comment state of file headers is always 0.
+static inline Header MakeHeader(const RARList &list, const RARListEntry &entry)
+{
+    Header header;
+    header.arcName = list.Names + entry.ArcName;
+    header.fileName = list.Names + entry.FileName;
+    header.redirName = list.Names + entry.RedirName;
+    unsigned long long fields[] = {
+        entry.Flags, entry.PackSize, entry.UnpSize, entry.HostOS, entry.UnpVer, entry.Method, entry.FileAttr,
+        entry.DictSize, 0
+    };
+    unsigned long long lazyFields[] = {
+        entry.FileTime, entry.Mtime, entry.Ctime, entry.Atime, entry.FileCRC, entry.HashType, entry.RedirType,
+        entry.DirTarget
+    };
+    memcpy(header.fields, fields, sizeof(header.fields));
+    memcpy(header.lazyFields, lazyFields, sizeof(header.lazyFields));
+    memset(header.hash, 0, sizeof(header.hash));
+    if (entry.HashType == RAR_HASH_BLAKE2) {
+        memcpy(header.hash, entry.Hash, sizeof(header.hash));
+    }
+    header.listed = true;
+    return header;
+}
+
+
+static inline bool operator==(const Header &a, const Header &b)
+{
+    return a.arcName == b.arcName && a.fileName == b.fileName && a.redirName == b.redirName &&
+           (a.listed || b.listed || a.fileNameA == b.fileNameA) &&
+           memcmp(a.fields, b.fields, sizeof(a.fields)) == 0 &&
+           memcmp(a.lazyFields, b.lazyFields, sizeof(a.lazyFields)) == 0 && memcmp(a.hash, b.hash, sizeof(a.hash)) == 0;
+}
+
+
+// Unpacks all entries through the callback path. Directories get empty entries.
+static inline bool ExtractWithCallback(const char *path, std::vector<Buffer> &entries, const char *password = NULL)
+{
+    HANDLE arc = OpenArchive(path, RAR_OM_EXTRACT);
+    if (arc == NULL) {
+        return false;
+    }
+    if (password != NULL) {
+        RARSetPassword(arc, (char *)password);
+    }
+
+    RARHeaderDataEx header;
+    memset(&header, 0, sizeof(header));
+    while (RARReadHeaderEx(arc, &header) == ERAR_SUCCESS) {
+        entries.push_back(Buffer());
+        RARSetCallback(arc, CopyDataCallback, (LPARAM)&entries.back());
+        int code = RARProcessFile(arc, RAR_TEST, NULL, NULL);
+        CHECK(code == ERAR_SUCCESS, "%s: callback extraction of %s returned %d", path, header.FileName, code);
+    }
+    RARCloseArchive(arc);
+    return true;
+}
+
+
+static inline bool ReadFile(const char *path, Buffer &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char chunk[0x10000];
+    size_t readSize;
+    while ((readSize = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + readSize);
+    }
+    fclose(file);
+    return true;
+}
+
+
+static inline bool WriteFile(const char *path, const Buffer &data)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool success = data.empty() || fwrite(&data[0], 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && success;
+}
+
+
+// Index is saved to temporary file and renamed, so every save gets a new inode.
+static inline ino_t IndexInode(const char *indexName)
+{
+    struct stat st;
+    return stat(indexName, &st) == 0 ? st.st_ino : 0;
+}
+
+
+static const unsigned char rar5Signature[] = {0x52, 0x61, 0x72, 0x21, 0x1a, 0x07, 0x01, 0x00};
+
+
+static inline unsigned int Crc32(const unsigned char *data, size_t size)
+{
+    static unsigned int table[256];
+    if (table[1] == 0) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) != 0 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+    unsigned int crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+static inline unsigned int Crc32(const Buffer &data)
+{
+    return data.empty() ? 0 : Crc32(&data[0], data.size());
+}
+
+
+static inline void PutVInt(Buffer &out, unsigned long long value)
+{
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        out.push_back(value != 0 ? byte | 0x80 : byte);
+    } while (value != 0);
+}
+
+
+static inline void Put32(Buffer &out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (i * 8)) & 0xff);
+    }
+}
+
+
+// Appends a block with CRC32 and size of given header fields.
+static inline void PutBlock(Buffer &out, const Buffer &header)
+{
+    Buffer block;
+    PutVInt(block, header.size());
+    block.insert(block.end(), header.begin(), header.end());
+    Put32(out, Crc32(block));
+    out.insert(out.end(), block.begin(), block.end());
+}
+
+
+// Appends signature and main header. Volumes after the first one have
+// volume number.
+static inline void PutMainHeader(Buffer &out, bool volume = false, unsigned int volumeNumber = 0)
+{
+    out.insert(out.end(), rar5Signature, rar5Signature + sizeof(rar5Signature));
+    Buffer main;
+    PutVInt(main, 1);  // Main header.
+    PutVInt(main, 0);  // Header flags.
+    PutVInt(main, (volume ? 1 : 0) | (volumeNumber > 0 ? 2 : 0));
+    if (volumeNumber > 0) {
+        PutVInt(main, volumeNumber);
+    }
+    PutBlock(out, main);
+}
+
+
+static inline void PutEndHeader(Buffer &out, bool nextVolume = false)
+{
+    Buffer end;
+    PutVInt(end, 5);  // End of archive header.
+    PutVInt(end, 0);
+    PutVInt(end, nextVolume ? 1 : 0);
+    PutBlock(out, end);
+}
+
+
+// Appends a record to the extra area of header.
+static inline void PutExtraRecord(Buffer &extra, unsigned long long type, const Buffer &fields)
+{
+    Buffer record;
+    PutVInt(record, type);
+    record.insert(record.end(), fields.begin(), fields.end());
+    PutVInt(extra, record.size());
+    extra.insert(extra.end(), record.begin(), record.end());
+}
+
+
+// Header of stored file, which packed data follows it.
+struct StoredHeader {
+    std::string name;
+    unsigned long long packSize;
+    unsigned long long unpSize;
+    unsigned int splitFlags;  // 0x08 if file continues from previous volume, 0x10 if in next one.
+    unsigned int mtime;       // Not stored if 0.
+    bool crcPresent;
+    unsigned int crc;         // Of this part only in not last parts of split file.
+    Buffer extra;             // Records added with PutExtraRecord.
+
+    StoredHeader(const std::string &fileName, const Buffer &data)
+        : name(fileName), packSize(data.size()), unpSize(data.size()), splitFlags(0), mtime(0),
+          crcPresent(true), crc(Crc32(data)) {}
+};
+
+
+static inline void PutFileHeader(Buffer &out, const StoredHeader &header)
+{
+    Buffer file;
+    PutVInt(file, 2);  // File header.
+    PutVInt(file, 2 | header.splitFlags | (header.extra.empty() ? 0 : 1));
+    if (!header.extra.empty()) {
+        PutVInt(file, header.extra.size());
+    }
+    PutVInt(file, header.packSize);
+    PutVInt(file, (header.mtime != 0 ? 2 : 0) | (header.crcPresent ? 4 : 0));
+    PutVInt(file, header.unpSize);
+    PutVInt(file, 0644);
+    if (header.mtime != 0) {
+        Put32(file, header.mtime);
+    }
+    if (header.crcPresent) {
+        Put32(file, header.crc);
+    }
+    PutVInt(file, 0);  // Stored.
+    PutVInt(file, 1);  // Unix.
+    PutVInt(file, header.name.size());
+    file.insert(file.end(), header.name.begin(), header.name.end());
+    file.insert(file.end(), header.extra.begin(), header.extra.end());
+    PutBlock(out, file);
+}
+
+
+struct StoredFile {
+    std::string name;
+    Buffer data;
+    unsigned int mtime;
+};
+
+
+// Single volume archive of stored files with CRC32 and modification time.
+static inline Buffer MakeStoredArchive(const std::vector<StoredFile> &files)
+{
+    Buffer archive;
+    PutMainHeader(archive);
+    for (size_t i = 0; i < files.size(); i++) {
+        StoredHeader header(files[i].name, files[i].data);
+        header.mtime = files[i].mtime;
+        PutFileHeader(archive, header);
+        archive.insert(archive.end(), files[i].data.begin(), files[i].data.end());
+    }
+    PutEndHeader(archive);
+    return archive;
+}
+
+
+// Files of random data with sizes below maxSize, named file0000.bin and so on.
+static inline std::vector<StoredFile> MakeRandomFiles(size_t fileCount, size_t maxSize)
+{
+    std::vector<StoredFile> files(fileCount);
+    srand(1);
+    for (size_t i = 0; i < fileCount; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "file%04zu.bin", i);
+        files[i].name = name;
+        files[i].data.resize(rand() % maxSize);
+        for (size_t j = 0; j < files[i].data.size(); j++) {
+            files[i].data[j] = (unsigned char)rand();
+        }
+        files[i].mtime = 1600000000 + (unsigned int)i;
+    }
+    return files;
+}
+
+#endif
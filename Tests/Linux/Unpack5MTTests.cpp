@@ -0,0 +1,161 @@
+//
+//  Unpack5MTTests.cpp
+//  UnrarKit
+//
+//  Checks data unpacked by the multithreaded RAR5 decoder from streams
+//  cut or damaged in the middle of a block header. All blocks preceding
+//  the bad header must be written, same as the single threaded decoder
+//  writes them. Streams are generated with literals only, because the
+//  library has no compressor. Built and run on Linux by Scripts/test-linux.sh
+//
+
+#include "TestInternals.h"
+
+
+// Bits are stored from the most significant one, as BitInput reads them.
+static void PutBits(Buffer &out, size_t &bitPos, unsigned int value, unsigned int bitCount)
+{
+    for (unsigned int i = bitCount; i-- > 0;) {
+        if (bitPos % 8 == 0) {
+            out.push_back(0);
+        }
+        if ((value >> i) & 1) {
+            out.back() |= 0x80 >> (bitPos % 8);
+        }
+        bitPos++;
+    }
+}
+
+
+// Huffman tables, where all 256 literals have 8 bit codes and other
+// symbols are not used. So code of literal is the literal itself.
+static Buffer LiteralTables()
+{
+    Buffer tables;
+    size_t bitPos = 0;
+    for (unsigned int i = 0; i < 20; i++) {
+        // Bit lengths 8 and "zeros with 7 bit count" have 1 bit codes.
+        PutBits(tables, bitPos, i == 8 || i == 19 ? 1 : 0, 4);
+    }
+    for (unsigned int i = 0; i < 256; i++) {
+        PutBits(tables, bitPos, 0, 1);
+    }
+    unsigned int zeroCount = 306 + 64 + 16 + 44 - 256;  // Main, distance, low distance and length tables.
+    while (zeroCount > 0) {
+        unsigned int count = Min(zeroCount, 138U);
+        PutBits(tables, bitPos, 1, 1);
+        PutBits(tables, bitPos, count - 11, 7);
+        zeroCount -= count;
+    }
+    return tables;  // Byte aligned, so the literals follow as is.
+}
+
+
+// RAR5 compressed stream with one literal block per blockSize bytes of data.
+// Returns stream positions of block headers.
+static std::vector<size_t> PackLiterals(const Buffer &data, size_t blockSize, Buffer &packed)
+{
+    Buffer tables = LiteralTables();
+    std::vector<size_t> headerPos;
+    for (size_t start = 0; start < data.size(); start += blockSize) {
+        size_t end = Min(start + blockSize, data.size());
+        unsigned int size = (unsigned int)(tables.size() + end - start);
+        unsigned char flags = 0x80 | (end == data.size() ? 0x40 : 0) | (1 << 3) | 7;
+        headerPos.push_back(packed.size());
+        packed.push_back(flags);
+        packed.push_back((unsigned char)(0x5a ^ flags ^ size ^ (size >> 8) ^ (size >> 16)));
+        packed.push_back(size & 0xff);
+        packed.push_back((size >> 8) & 0xff);
+        packed.insert(packed.end(), tables.begin(), tables.end());
+        packed.insert(packed.end(), data.begin() + start, data.begin() + end);
+    }
+    return headerPos;
+}
+
+
+// Unpacks stream read from file with given number of threads.
+static Buffer UnpackStream(const char *path, size_t packedSize, size_t unpSize, unsigned int threads)
+{
+    Buffer unpacked;
+    CommandData cmd;
+    cmd.DllOpMode = RAR_TEST;
+    cmd.Callback = CopyDataCallback;
+    cmd.UserData = (LPARAM)&unpacked;
+
+    Archive arc(&cmd);
+    wchar name[NM];
+    CharToWide(path, name, ASIZE(name));
+    CHECK(arc.Open(name), "%s: cannot open", path);
+
+    ComprDataIO dataIO;
+    dataIO.SetFiles(&arc, NULL);
+    dataIO.SetNoFileHeader(true);
+    dataIO.SetPackedSizeToRead(packedSize);
+    dataIO.SetTestMode(true);
+    dataIO.SetSkipUnpCRC(true);
+
+    Unpack unpack(&dataIO);
+    unpack.SetThreads(threads);
+    unpack.Init(0x400000, false);
+    unpack.SetDestSize(unpSize);
+    unpack.DoUnpack(VER_UNPACK5, false);
+    return unpacked;
+}
+
+
+static void CheckStream(const char *path, const Buffer &packed, const Buffer &expected, const char *damage)
+{
+    CHECK(WriteFile(path, packed), "%s: cannot write", path);
+    Buffer single = UnpackStream(path, packed.size(), expected.size() + 0x100000, 1);
+    Buffer multi = UnpackStream(path, packed.size(), expected.size() + 0x100000, 4);
+    unlink(path);
+
+    // Single threaded decoder writes the window only when it is full,
+    // so it can lose the last data. It must never write more.
+    CHECK(multi == expected, "%s: %zu of %zu bytes unpacked by threads %s", path, multi.size(), expected.size(),
+          damage);
+    CHECK(single.size() <= expected.size() && std::equal(single.begin(), single.end(), expected.begin()),
+          "%s: single threaded data differs %s", path, damage);
+}
+
+
+int main()
+{
+    char directory[] = "/tmp/unrar-mt-test.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+    std::string path = std::string(directory) + "/stream.bin";
+
+    // About a dozen passes of 4 threads with 16 KB blocks.
+    const size_t blockSize = 16000;
+    Buffer data(3000000);
+    srand(1);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (unsigned char)rand();
+    }
+    Buffer packed;
+    std::vector<size_t> headerPos = PackLiterals(data, blockSize, packed);
+
+    int previousFailures = failures;
+    CheckStream(path.c_str(), packed, data, "from intact stream");
+
+    // Bad headers in the first pass, inside following passes and in the last block.
+    size_t badBlocks[] = {1, 37, 100, 101, headerPos.size() - 1};
+    for (size_t i = 0; i < sizeof(badBlocks) / sizeof(badBlocks[0]); i++) {
+        size_t block = badBlocks[i];
+        Buffer expected(data.begin(), data.begin() + block * blockSize);
+
+        Buffer cut(packed.begin(), packed.begin() + headerPos[block] + 2);
+        CheckStream(path.c_str(), cut, expected, "when cut in block header");
+
+        Buffer damaged = packed;
+        damaged[headerPos[block] + 1] ^= 0x55;  // Header checksum.
+        CheckStream(path.c_str(), damaged, expected, "with damaged block header");
+    }
+
+    rmdir(directory);
+    PrintResult(path.c_str(), headerPos.size(), previousFailures);
+    return TestResult();
+}
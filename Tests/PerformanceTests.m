@@ -0,0 +1,223 @@
+//
+//  PerformanceTests.m
+//  UnrarKit
+//
+//
+
+#import "URKArchiveTestCase.h"
+
+
+@interface PerformanceTests : URKArchiveTestCase @end
+
+@implementation PerformanceTests
+
+#if !TARGET_OS_IPHONE
+- (void)testPerformance_ExtractRAR5_CompressibleLog
+{
+    NSUInteger fileSize = 32000000;
+    NSURL *logFile = [self logTextFileOfLength:fileSize];
+    NSURL *archiveURL = [self archiveWithFiles:@[logFile] arguments:@[@"-ma5", @"-m3"]];
+    XCTAssertNotNil(archiveURL, @"No archive URL returned");
+
+    URKArchive *archive = [[URKArchive alloc] initWithURL:archiveURL error:nil];
+
+    [self measureBlock:^{
+        __block unsigned long long bytesDecompressed = 0;
+        NSDate *startTime = [NSDate date];
+
+        NSError *error = nil;
+        BOOL success = [archive extractBufferedDataFromFile:logFile.lastPathComponent
+                                                      error:&error
+                                                     action:
+                        ^(NSData *dataChunk, CGFloat percentDecompressed) {
+                            bytesDecompressed += dataChunk.length;
+                        }];
+
+        NSTimeInterval elapsed = -[startTime timeIntervalSinceNow];
+
+        XCTAssertTrue(success, @"Failed to read buffered data");
+        XCTAssertNil(error, @"Error reading buffered data");
+        XCTAssertEqual(bytesDecompressed, (unsigned long long)fileSize, @"Wrong number of bytes decompressed");
+
+        NSLog(@"Decompressed %llu bytes at %.1f MB/s", bytesDecompressed, bytesDecompressed / elapsed / 1000000.0);
+    }];
+}
+
+- (void)testPerformance_ExtractRAR5_Text
+{
+    NSURL *textFile = [self randomTextFileOfLength:5000000];
+    NSURL *archiveURL = [self archiveWithFiles:@[textFile] arguments:@[@"-ma5", @"-m3"]];
+    XCTAssertNotNil(archiveURL, @"No archive URL returned");
+
+    URKArchive *archive = [[URKArchive alloc] initWithURL:archiveURL error:nil];
+    NSData *originalData = [NSData dataWithContentsOfURL:textFile];
+
+    [self measureBlock:^{
+        NSDate *startTime = [NSDate date];
+
+        NSError *error = nil;
+        NSData *extractedData = [archive extractDataFromFile:textFile.lastPathComponent
+                                                       error:&error];
+
+        NSTimeInterval elapsed = -[startTime timeIntervalSinceNow];
+
+        XCTAssertNil(error, @"Error extracting data");
+        XCTAssertTrue([originalData isEqualToData:extractedData], @"Data didn't restore correctly");
+
+        NSLog(@"Decompressed %lu bytes at %.1f MB/s", (unsigned long)extractedData.length, extractedData.length / elapsed / 1000000.0);
+    }];
+}
+
+- (void)testPerformance_ListFilenames_QuickOpen
+{
+    NSUInteger fileCount = 1000;
+    NSURL *archiveURL = [self quickOpenArchiveWithFileCount:fileCount];
+    [self measureListingFilenamesInArchive:archiveURL fileCount:fileCount ignoringQuickOpenInformation:NO];
+}
+
+- (void)testPerformance_ListFilenames_IgnoringQuickOpen
+{
+    NSUInteger fileCount = 1000;
+    NSURL *archiveURL = [self quickOpenArchiveWithFileCount:fileCount];
+    [self measureListingFilenamesInArchive:archiveURL fileCount:fileCount ignoringQuickOpenInformation:YES];
+}
+
+- (void)testPerformance_ExtractDataByName_HeaderIndex_QuickOpen
+{
+    NSUInteger fileCount = 1000;
+    NSURL *archiveURL = [self quickOpenArchiveWithFileCount:fileCount];
+    [self measureLookingUpFilesInArchive:archiveURL fileCount:fileCount useHeaderIndex:YES ignoringQuickOpenInformation:NO];
+}
+
+- (void)testPerformance_ExtractDataByName_HeaderIndex_IgnoringQuickOpen
+{
+    NSUInteger fileCount = 1000;
+    NSURL *archiveURL = [self quickOpenArchiveWithFileCount:fileCount];
+    [self measureLookingUpFilesInArchive:archiveURL fileCount:fileCount useHeaderIndex:YES ignoringQuickOpenInformation:YES];
+}
+
+- (void)testPerformance_ExtractDataByName_Scanning_QuickOpen
+{
+    NSUInteger fileCount = 1000;
+    NSURL *archiveURL = [self quickOpenArchiveWithFileCount:fileCount];
+    [self measureLookingUpFilesInArchive:archiveURL fileCount:fileCount useHeaderIndex:NO ignoringQuickOpenInformation:NO];
+}
+
+
+#pragma mark - Helper Methods
+
+
+- (void)measureListingFilenamesInArchive:(NSURL *)archiveURL
+                               fileCount:(NSUInteger)fileCount
+            ignoringQuickOpenInformation:(BOOL)ignoreQuickOpen
+{
+    [self measureBlock:^{
+        // Archive is opened by every listing, so opening time is included
+        URKArchive *archive = [[URKArchive alloc] initWithURL:archiveURL error:nil];
+        archive.ignoreQuickOpenInformation = ignoreQuickOpen;
+
+        NSDate *startTime = [NSDate date];
+
+        NSError *error = nil;
+        NSArray<NSString*> *filenames = [archive listFilenames:&error];
+
+        NSTimeInterval elapsed = -[startTime timeIntervalSinceNow];
+
+        XCTAssertNil(error, @"Error listing filenames");
+        XCTAssertEqual(filenames.count, fileCount, @"Wrong number of files listed");
+
+        NSLog(@"Opened and listed %lu files in %.1f ms", (unsigned long)filenames.count, elapsed * 1000.0);
+    }];
+}
+
+- (void)measureLookingUpFilesInArchive:(NSURL *)archiveURL
+                             fileCount:(NSUInteger)fileCount
+                        useHeaderIndex:(BOOL)useHeaderIndex
+          ignoringQuickOpenInformation:(BOOL)ignoreQuickOpen
+{
+    NSURL *indexURL = nil;
+    if (useHeaderIndex) {
+        // The index is saved by the first listing, so lookups only read it
+        indexURL = [self.tempDirectory URLByAppendingPathComponent:@"lookup.idx"];
+        URKArchive *archive = [[URKArchive alloc] initWithURL:archiveURL error:nil];
+        archive.headerIndexURL = indexURL;
+        XCTAssertNotNil([archive listFilenames:nil], @"Error saving header index");
+    }
+
+    NSUInteger lookupCount = 20;
+
+    [self measureBlock:^{
+        URKArchive *archive = [[URKArchive alloc] initWithURL:archiveURL error:nil];
+        archive.headerIndexURL = indexURL;
+        archive.ignoreQuickOpenInformation = ignoreQuickOpen;
+
+        NSDate *startTime = [NSDate date];
+
+        // Every extraction opens the archive, and going backwards from the last file
+        // makes each header lie before the previous one
+        for (NSUInteger i = 0; i < lookupCount; i++) {
+            NSString *filename = [NSString stringWithFormat:@"%05lu.bin", (unsigned long)(fileCount - 1 - i)];
+            NSError *error = nil;
+            NSData *data = [archive extractDataFromFile:filename error:&error];
+            XCTAssertNil(error, @"Error extracting %@", filename);
+            XCTAssertEqual(data.length, (NSUInteger)50000, @"Wrong size of %@", filename);
+        }
+
+        NSTimeInterval elapsed = -[startTime timeIntervalSinceNow];
+
+        NSLog(@"Opened archive and extracted a file in %.2f ms on average", elapsed * 1000.0 / lookupCount);
+    }];
+}
+
+- (NSURL *)quickOpenArchiveWithFileCount:(NSUInteger)fileCount {
+    NSMutableArray<NSURL *> *files = [NSMutableArray arrayWithCapacity:fileCount];
+    NSMutableData *data = [NSMutableData dataWithLength:50000];
+
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        arc4random_buf(data.mutableBytes, data.length);
+        NSURL *fileURL = [self.tempDirectory URLByAppendingPathComponent:
+                          [NSString stringWithFormat:@"%05lu.bin", (unsigned long)i]];
+        XCTAssertTrue([data writeToURL:fileURL atomically:NO], @"Error writing file %@", fileURL);
+        [files addObject:fileURL];
+    }
+
+    // Headers of stored files are far apart in the archive, and all of them are copied
+    // to the quick open information
+    NSURL *archiveURL = [self archiveWithFiles:files arguments:@[@"-ma5", @"-m0", @"-qo+"]];
+    XCTAssertNotNil(archiveURL, @"No archive URL returned");
+
+    return archiveURL;
+}
+
+
+- (NSURL *)logTextFileOfLength:(NSUInteger)numberOfCharacters {
+    NSArray<NSString *> *levels = @[@"INFO", @"WARN", @"DEBUG", @"ERROR"];
+    NSArray<NSString *> *components = @[@"http", @"db", @"cache", @"auth", @"queue"];
+
+    NSMutableString *logString = [NSMutableString stringWithCapacity:numberOfCharacters];
+    NSTimeInterval timestamp = 1600000000;
+
+    while (logString.length < numberOfCharacters) {
+        timestamp += arc4random_uniform(10000) / 1000000.0;
+        [logString appendFormat:@"%.3f [%@] %@: request %u served in %u ms\n",
+         timestamp,
+         levels[arc4random_uniform((uint32_t)levels.count)],
+         components[arc4random_uniform((uint32_t)components.count)],
+         arc4random_uniform(100000),
+         arc4random_uniform(1000)];
+    }
+
+    [logString deleteCharactersInRange:NSMakeRange(numberOfCharacters, logString.length - numberOfCharacters)];
+
+    NSURL *resultURL = [self.tempDirectory URLByAppendingPathComponent:
+                        [NSString stringWithFormat:@"%@.log", [[NSProcessInfo processInfo] globallyUniqueString]]];
+
+    NSError *error = nil;
+    [logString writeToURL:resultURL atomically:YES encoding:NSUTF8StringEncoding error:&error];
+    XCTAssertNil(error, @"Error writing log file: %@", error);
+
+    return resultURL;
+}
+#endif
+
+@end